@@ -0,0 +1,254 @@
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <iterator>
+
+#include "AnalysisStore.h"
+#include "Zobrist.h"
+
+namespace BixNix {
+
+namespace {
+
+bool writeAll(const int fd, const void* buffer, size_t bytes) {
+  const char* data = static_cast<const char*>(buffer);
+  while (bytes > 0) {
+    const ssize_t written = write(fd, data, bytes);
+    if (written < 0 && EINTR == errno) continue;
+    if (written <= 0) return false;
+    data += written;
+    bytes -= written;
+  }
+  return true;
+}
+
+bool readAll(const int fd, void* buffer, size_t bytes) {
+  char* data = static_cast<char*>(buffer);
+  while (bytes > 0) {
+    const ssize_t got = read(fd, data, bytes);
+    if (got < 0 && EINTR == errno) continue;
+    if (got <= 0) return false;
+    data += got;
+    bytes -= got;
+  }
+  return true;
+}
+}
+
+AnalysisStore::AnalysisStore()
+    : _fd(-1),
+      _mapping(nullptr),
+      _mappingBytes(0),
+      _records(nullptr),
+      _sorted(0) {}
+
+AnalysisStore::~AnalysisStore() { close(); }
+
+// Creates the file if there is none. Appended records are read into memory;
+// a record cut short by a crash is dropped so later appends stay aligned.
+bool AnalysisStore::open(const std::string& path) {
+  close();
+
+  const int fd = ::open(path.c_str(), O_RDWR | O_CREAT, 0644);
+  if (fd < 0) return false;
+
+  FileHeader header;
+  struct stat status;
+  bool success = (0 == fstat(fd, &status));
+  if (success && 0 == status.st_size) {
+    std::vector<char> page(FileHeader::PAGE, 0);
+    FileHeader& fresh = *reinterpret_cast<FileHeader*>(page.data());
+    fresh._magic = FileHeader::MAGIC;
+    fresh._version = FileHeader::VERSION;
+    fresh._recordBytes = sizeof(Record);
+    fresh._zobristSeed = Zobrist::SEED;
+    fresh._runCount = 0;
+    success = writeAll(fd, page.data(), page.size()) && 0 == fstat(fd, &status);
+  }
+
+  const size_t bytes = success ? size_t(status.st_size) : 0;
+  success = success && 0 == lseek(fd, 0, SEEK_SET) &&
+            readAll(fd, &header, sizeof(header)) &&
+            FileHeader::MAGIC == header._magic &&
+            FileHeader::VERSION == header._version &&
+            sizeof(Record) == header._recordBytes &&
+            Zobrist::SEED == header._zobristSeed &&
+            header._runCount <= FileHeader::MAX_RUNS;
+
+  size_t sorted = 0;
+  if (success)
+    for (size_t i = 0; i < header._runCount; ++i) sorted += header._runs[i];
+  success = success && bytes >= FileHeader::PAGE + sorted * sizeof(Record);
+
+  size_t appended = 0;
+  if (success) {
+    const size_t sortedEnd = FileHeader::PAGE + sorted * sizeof(Record);
+    appended = (bytes - sortedEnd) / sizeof(Record);
+    const size_t end = sortedEnd + appended * sizeof(Record);
+    _appended.resize(appended);
+    success = (end == bytes || 0 == ftruncate(fd, end)) &&
+              off_t(sortedEnd) == lseek(fd, sortedEnd, SEEK_SET) &&
+              readAll(fd, _appended.data(), appended * sizeof(Record)) &&
+              off_t(end) == lseek(fd, 0, SEEK_END);
+    _mappingBytes = sortedEnd;
+  }
+
+  if (success) {
+    _mapping = mmap(nullptr, _mappingBytes, PROT_READ, MAP_SHARED, fd, 0);
+    success = (MAP_FAILED != _mapping);
+  }
+
+  if (!success) {
+    _mapping = nullptr;
+    _mappingBytes = 0;
+    _appended.clear();
+    ::close(fd);
+    return false;
+  }
+
+  _path = path;
+  _fd = fd;
+  _records = reinterpret_cast<const Record*>(static_cast<char*>(_mapping) +
+                                             FileHeader::PAGE);
+  _sorted = sorted;
+  _runs.assign(header._runs, header._runs + header._runCount);
+  return true;
+}
+
+void AnalysisStore::close() {
+  if (nullptr != _mapping) munmap(_mapping, _mappingBytes);
+  if (_fd >= 0) ::close(_fd);
+  _fd = -1;
+  _mapping = nullptr;
+  _mappingBytes = 0;
+  _records = nullptr;
+  _sorted = 0;
+  _runs.clear();
+  _appended.clear();
+}
+
+// Deeper wins; at equal depth the one that came later.
+bool AnalysisStore::isBetter(const Record& candidate,
+                             const Record& incumbent) {
+  return candidate.depth >= incumbent.depth;
+}
+
+bool AnalysisStore::find(const Board& board, Record& record) const {
+  if (!isOpen()) return false;
+
+  const ZobristNumber key(board.getHash());
+  const Board::Signature signature(board.getSignature());
+  bool found = false;
+  auto consider = [&](const Record& candidate) {
+    if (candidate.key != key || !(candidate.signature == signature)) return;
+    if (found && !isBetter(candidate, record)) return;
+    record = candidate;
+    found = true;
+  };
+
+  const Record* run = _records;
+  for (const uint64_t length : _runs) {
+    const Record* end = run + length;
+    const Record* begin = std::lower_bound(
+        run, end, key, [](const Record& lhs, const ZobristNumber rhs) {
+          return lhs.key < rhs;
+        });
+    for (const Record* it = begin; it != end && it->key == key; ++it)
+      consider(*it);
+    run = end;
+  }
+  for (const Record& candidate : _appended) consider(candidate);
+  return found;
+}
+
+// One write to the end of the file; the sorted run stays untouched.
+bool AnalysisStore::append(const Record& record) {
+  if (!isOpen()) return false;
+  if (!writeAll(_fd, &record, sizeof(record))) return false;
+  _appended.push_back(record);
+  if (_appended.size() >= COMPACT_RECORDS) return compact();
+  return true;
+}
+
+// Positions sharing a key are rare, so each run of one key is small.
+void AnalysisStore::keepBest(std::vector<Record>& records) {
+  size_t kept = 0;
+  size_t run = 0;
+  for (size_t i = 0; i < records.size(); ++i) {
+    const Record record(records[i]);
+    if (kept > 0 && records[kept - 1].key != record.key) run = kept;
+    auto same = std::find_if(records.begin() + run, records.begin() + kept,
+                             [&](const Record& candidate) {
+                               return candidate.signature == record.signature;
+                             });
+    if (records.begin() + kept == same)
+      records[kept++] = record;
+    else if (isBetter(record, *same))
+      *same = record;
+  }
+  records.resize(kept);
+}
+
+bool AnalysisStore::writeHeader(const size_t runCount) const {
+  FileHeader header;
+  std::memset(&header, 0, sizeof(header));
+  header._magic = FileHeader::MAGIC;
+  header._version = FileHeader::VERSION;
+  header._recordBytes = sizeof(Record);
+  header._zobristSeed = Zobrist::SEED;
+  header._runCount = runCount;
+  std::copy(_runs.begin(), _runs.begin() + runCount, header._runs);
+  return 0 == lseek(_fd, 0, SEEK_SET) &&
+         writeAll(_fd, &header, sizeof(header));
+}
+
+// Sorts the appended records into a new run, then merges it with the
+// newest runs while they are no more than twice its size, rewriting only
+// the tail of the file those runs took up. Until the final header is
+// written the tail reads back as appended records, so a crash part way
+// through can lose results but leaves the runs sound.
+bool AnalysisStore::compact() {
+  if (!isOpen()) return false;
+  if (_appended.empty()) return true;
+
+  std::vector<Record> merged(_appended);
+  std::stable_sort(merged.begin(), merged.end(), isEarlier);
+  keepBest(merged);
+
+  size_t runCount = _runs.size();
+  size_t start = _sorted;
+  while (runCount > 0 && (_runs[runCount - 1] <= 2 * merged.size() ||
+                          FileHeader::MAX_RUNS == runCount)) {
+    const size_t length = _runs[--runCount];
+    start -= length;
+    // the older run goes first so that at equal keys the newer stays later
+    std::vector<Record> both;
+    both.reserve(length + merged.size());
+    std::merge(_records + start, _records + start + length, merged.begin(),
+               merged.end(), std::back_inserter(both), isEarlier);
+    keepBest(both);
+    merged.swap(both);
+  }
+
+  const off_t offset = FileHeader::PAGE + start * sizeof(Record);
+  const size_t bytes = merged.size() * sizeof(Record);
+  bool success = writeHeader(runCount) &&
+                 offset == lseek(_fd, offset, SEEK_SET) &&
+                 writeAll(_fd, merged.data(), bytes) &&
+                 0 == ftruncate(_fd, offset + bytes);
+  if (success) {
+    _runs.resize(runCount);
+    _runs.push_back(merged.size());
+    success = writeHeader(_runs.size());
+  }
+
+  // either way the file now says what is in it
+  const std::string path(_path);
+  return open(path) && success;
+}
+}
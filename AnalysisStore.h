@@ -0,0 +1,94 @@
+//
+// AnalysisStore.h
+//
+
+#ifndef __ANALYSISSTORE_H__
+#define __ANALYSISSTORE_H__
+
+#include <string>
+#include <vector>
+
+#include "Board.h"
+#include "Enums.h"
+#include "Move.h"
+
+namespace BixNix {
+
+// Finished searches kept on disk, so a position analysed once is a lookup
+// the next time. The file is a header page, runs of records sorted by key
+// that are mapped and binary searched, then records appended since. Once
+// enough have been appended, compact() sorts them into a new run, merged
+// with the runs before it until each run is over twice the size of the
+// next, so a record is only rewritten a logarithmic number of times.
+// Only one process should have a given file open at a time.
+class AnalysisStore {
+ public:
+  static const int PV_LENGTH = 9;
+  static const size_t COMPACT_RECORDS = 1024;
+
+  struct Record {
+    ZobristNumber key;
+    Board::Signature signature;
+    Move::Data pv[PV_LENGTH];  // best move first, zero past pvLength
+    Score score;
+    Depth depth;
+    uint8_t pvLength;
+  };
+
+  AnalysisStore();
+  ~AnalysisStore();
+
+  bool open(const std::string& path);
+  void close();
+  bool isOpen() const { return _fd >= 0; }
+
+  // The deepest result for exactly this position.
+  bool find(const Board& board, Record& record) const;
+  // Compacts on its own once COMPACT_RECORDS have piled up.
+  bool append(const Record& record);
+  bool compact();
+
+  size_t getSorted() const { return _sorted; }
+  size_t getRuns() const { return _runs.size(); }
+  size_t getAppended() const { return _appended.size(); }
+
+ private:
+  struct FileHeader {
+    static const uint64_t MAGIC = 0x5341584e5842ULL;  // "BXNXAS"
+    static const uint32_t VERSION = 2;
+    static const size_t PAGE = 4096;
+    // each run is over twice the next, so this many can't be outgrown
+    static const size_t MAX_RUNS = 64;
+
+    uint64_t _magic;
+    uint32_t _version;
+    uint32_t _recordBytes;
+    uint64_t _zobristSeed;
+    uint64_t _runCount;
+    uint64_t _runs[MAX_RUNS];  // records in each run, oldest first
+  };
+
+  static_assert(sizeof(Record) == 128, "Record should pack to 128 bytes");
+  static_assert(sizeof(FileHeader) <= FileHeader::PAGE,
+                "FileHeader should fit its page");
+
+  static bool isBetter(const Record& candidate, const Record& incumbent);
+  static bool isEarlier(const Record& lhs, const Record& rhs) {
+    return lhs.key < rhs.key;
+  }
+  // Keeps the best record of each position in records sorted by key.
+  static void keepBest(std::vector<Record>& records);
+  bool writeHeader(const size_t runCount) const;
+
+  std::string _path;
+  int _fd;
+  void* _mapping;
+  size_t _mappingBytes;
+  const Record* _records;
+  size_t _sorted;
+  std::vector<uint64_t> _runs;
+  std::vector<Record> _appended;
+};
+}
+
+#endif  // __ANALYSISSTORE_H__
@@ -14,13 +14,17 @@ class BNStack {
   BNStack& operator=(const BNStack& that) {
     _data = that._data;
     _head_index = that._head_index;
+    return *this;
   }
 
   ~BNStack() {}
 
   void push(const T& data) { _data[_head_index++] = data; }
   void pop() { --_head_index; }
-  const T& top() { return _data[_head_index - 1]; }
+  // pushes the slot as it was last left, for the caller to fill in
+  T& grow() { return _data[_head_index++]; }
+  T& top() { return _data[_head_index - 1]; }
+  const T& top() const { return _data[_head_index - 1]; }
   const T& deepTop(int i) { return _data[_head_index - 1 - i]; }
   size_t size() { return _head_index; }
   void clear() { _head_index = 0; }
@@ -16,27 +16,165 @@ const BitBoard notAFile = 0x7F7F7F7F7F7F7F7F;
 const BitBoard notABFile = 0x3F3F3F3F3F3F3F3F;
 const BitBoard notHFile = 0xFEFEFEFEFEFEFEFE;
 const BitBoard notGHFile = 0xFCFCFCFCFCFCFCFC;
+// h1, bit 0, is a light square
+const BitBoard lightSquares = 0xAA55AA55AA55AA55;
 
 // Kogge-Stone routines from
 // https://chessprogramming.wikispaces.com/Kogge-Stone+Algorithm
+// They are constexpr so the attack tables can be built by the compiler.
 
-BitBoard smearN(BitBoard generator, BitBoard clear);
-BitBoard smearNE(BitBoard generator, BitBoard clear);
-BitBoard smearE(BitBoard generator, BitBoard clear);
-BitBoard smearSE(BitBoard generator, BitBoard clear);
-BitBoard smearS(BitBoard generator, BitBoard clear);
-BitBoard smearSW(BitBoard generator, BitBoard clear);
-BitBoard smearW(BitBoard generator, BitBoard clear);
-BitBoard smearNW(BitBoard generator, BitBoard clear);
-
-BitBoard shiftN(BitBoard source);
-BitBoard shiftNE(BitBoard source);
-BitBoard shiftE(BitBoard source);
-BitBoard shiftSE(BitBoard source);
-BitBoard shiftS(BitBoard source);
-BitBoard shiftSW(BitBoard source);
-BitBoard shiftW(BitBoard source);
-BitBoard shiftNW(BitBoard source);
+constexpr BitBoard smearN(BitBoard g, BitBoard p) {
+  g |= p & (g << 8);
+  p &= (p << 8);
+  g |= p & (g << 16);
+  p &= (p << 16);
+  g |= p & (g << 32);
+  return g;
+}
+
+constexpr BitBoard smearNE(BitBoard g, BitBoard p) {
+  p &= notAFile;
+  g |= p & (g << 7);
+  p &= (p << 7);
+  g |= p & (g << 14);
+  p &= (p << 14);
+  g |= p & (g << 28);
+  return g;
+}
+
+constexpr BitBoard smearE(BitBoard g, BitBoard p) {
+  p &= notAFile;
+  g |= p & (g >> 1);
+  p &= (p >> 1);
+  g |= p & (g >> 2);
+  p &= (p >> 2);
+  g |= p & (g >> 4);
+  return g;
+}
+
+constexpr BitBoard smearSE(BitBoard g, BitBoard p) {
+  p &= notAFile;
+  g |= p & (g >> 9);
+  p &= (p >> 9);
+  g |= p & (g >> 18);
+  p &= (p >> 18);
+  g |= p & (g >> 36);
+  return g;
+}
+
+constexpr BitBoard smearS(BitBoard g, BitBoard p) {
+  g |= p & (g >> 8);
+  p &= (p >> 8);
+  g |= p & (g >> 16);
+  p &= (p >> 16);
+  g |= p & (g >> 32);
+  return g;
+}
+
+constexpr BitBoard smearSW(BitBoard g, BitBoard p) {
+  p &= notHFile;
+  g |= p & (g >> 7);
+  p &= (p >> 7);
+  g |= p & (g >> 14);
+  p &= (p >> 14);
+  g |= p & (g >> 28);
+  return g;
+}
+
+constexpr BitBoard smearW(BitBoard g, BitBoard p) {
+  p &= notHFile;
+  g |= p & (g << 1);
+  p &= (p << 1);
+  g |= p & (g << 2);
+  p &= (p << 2);
+  g |= p & (g << 4);
+  return g;
+}
+
+constexpr BitBoard smearNW(BitBoard g, BitBoard p) {
+  p &= notHFile;
+  g |= p & (g << 9);
+  p &= (p << 9);
+  g |= p & (g << 18);
+  p &= (p << 18);
+  g |= p & (g << 36);
+  return g;
+}
+
+constexpr BitBoard shiftN(BitBoard source) { return source << 8; }
+
+constexpr BitBoard shiftNE(BitBoard source) { return (source & notHFile) << 7; }
+
+constexpr BitBoard shiftE(BitBoard source) { return (source & notHFile) >> 1; }
+
+constexpr BitBoard shiftSE(BitBoard source) { return (source & notHFile) >> 9; }
+
+constexpr BitBoard shiftS(BitBoard source) { return source >> 8; }
+
+constexpr BitBoard shiftSW(BitBoard source) { return (source & notAFile) >> 7; }
+
+constexpr BitBoard shiftW(BitBoard source) { return (source & notAFile) << 1; }
+
+constexpr BitBoard shiftNW(BitBoard source) { return (source & notAFile) << 9; }
+
+// Shifts toward higher squares for positive delta, lower for negative.
+template <int delta>
+constexpr BitBoard shift(const BitBoard board) {
+  return (delta > 0) ? (board << delta) : (board >> -delta);
+}
+
+// The lowest set square of a non-empty board, a single tzcnt.
+constexpr Square getLowestSquare(const BitBoard board) {
+  return __builtin_ctzll(board);
+}
+
+// Clears the lowest set square of a non-empty board, as blsr does, and
+// returns it. Loops over a board's squares are built on this.
+constexpr Square popLowestSquare(BitBoard& board) {
+  const Square square(getLowestSquare(board));
+  board &= board - 1;
+  return square;
+}
+
+// A slider's attacks along one line, given the rays below and above its
+// square. The nearest blocker below is isolated by its leading zeros, and
+// subtracting it from the blockers above borrows up to the nearest of
+// those, setting every square in between.
+inline BitBoard obstructionDifference(const BitBoard lower,
+                                      const BitBoard upper,
+                                      const BitBoard occupied) {
+  const BitBoard above(upper & occupied);
+  const BitBoard nearestBelow(0x8000000000000000ULL >>
+                              __builtin_clzll((lower & occupied) | 1));
+  return (lower | upper) & (above ^ (above - nearestBelow));
+}
+
+// The low bits of bits spread out over the set squares of mask, lowest to
+// lowest, as BMI2's pdep does. Numbering blocker sets this way is what
+// lets pext index a table.
+constexpr BitBoard depositBits(BitBoard bits, BitBoard mask) {
+  BitBoard result(0LL);
+  for (; 0LL != mask; mask &= mask - 1, bits >>= 1)
+    if (bits & 1) result |= mask & (0LL - mask);
+  return result;
+}
+
+// Directions, ranks and home squares as one side sees them, so code
+// templated on the side to move gets them as constants.
+template <Color color>
+struct Side {
+  static constexpr Color OTHER = Color(1 - color);
+  static constexpr int FORWARD = (White == color) ? 8 : -8;
+  static constexpr int WEST = (White == color) ? 9 : -7;  // capturing
+  static constexpr int EAST = (White == color) ? 7 : -9;
+  static constexpr int HOME = (White == color) ? 0 : 56;  // first square
+  static constexpr int PASSANT = (White == color) ? 40 : 16;  // + file
+  static constexpr BitBoard LAST_RANK = 0xFFLL << (56 - HOME);
+  // where a single push from the starting rank lands
+  static constexpr BitBoard PUSHED_RANK = (White == color)
+                                              ? 0x0000000000FF0000LL
+                                              : 0x0000FF0000000000LL;
+};
 }
 
 #endif  // __BITBOARD_H__
@@ -4,46 +4,65 @@
 #include "Board.h"
 #include "Enums.h"
 #include "Bishops.h"
+#include "Cuckoo.h"
+#include "Fills.h"
 #include "Kings.h"
 #include "Knights.h"
+#include "Lines.h"
 #include "Pawns.h"
 #include "Rooks.h"
 #include "Zobrist.h"
 #include "Evaluate.h"
+#include "MaterialTable.h"
 
 #include "Logger.h"
 
 namespace BixNix {
 
+const uint8_t Board::EMPTY;
+
 Board::Board()
     : _dirty(0LL),
       _toMove(White),
       _hash(0),
+      _pawnHash(0),
+      _materialKey(0),
       _epAvailable(-1),
       _terminalState(Running) {
   _pieces.fill(0LL);
   _colors.fill(0LL);
+  _mailbox.fill(EMPTY);
+  _draw100Counter.push(0);
+  _status.push(Status());
 }
 
 Board::Board(const Board& that)
     : _pieces(that._pieces),
       _colors(that._colors),
+      _mailbox(that._mailbox),
       _moves(that._moves),
       _draw100Counter(that._draw100Counter),
+      _status(that._status),
       _dirty(that._dirty),
       _toMove(that._toMove),
       _hash(that._hash),
+      _pawnHash(that._pawnHash),
+      _materialKey(that._materialKey),
       _epAvailable(that._epAvailable),
       _terminalState(that._terminalState) {}
 
 Board& Board::operator=(const Board& that) {
   _pieces = that._pieces;
   _colors = that._colors;
+  _mailbox = that._mailbox;
   _dirty = that._dirty;
   _moves = that._moves;
   _draw100Counter = that._draw100Counter;
+  _status = that._status;
   _toMove = that._toMove;
   _hash = that._hash;
+  _pawnHash = that._pawnHash;
+  _materialKey = that._materialKey;
   _epAvailable = that._epAvailable;
   _terminalState = that._terminalState;
   return *this;
@@ -56,6 +75,10 @@ bool Board::operator==(const Board& rhs) const {
     LOG(trace) << "hash is different";
     result = false;
   }
+  if (_pawnHash != rhs._pawnHash) {
+    LOG(trace) << "pawn hash is different";
+    result = false;
+  }
   if (_dirty != rhs._dirty) {
     LOG(trace) << "dirty is different";
     result = false;
@@ -132,6 +155,7 @@ void Board::debug() const {
   LOG(trace) << "Queen\n" << RenderBB(_pieces[Queen]);
   LOG(trace) << "King\n" << RenderBB(_pieces[King]);
   LOG(trace) << "Pawn\n" << RenderBB(_pieces[Pawn]);
+  LOG(trace) << "board\n" << *this;
 }
 
 Board::~Board() {}
@@ -139,86 +163,69 @@ Board::~Board() {}
 void Board::applyExternalMove(const Move extMove) {
   // moves that come from the outside don't have all the handy flags
   // so analyze it and set the proper flags
-  Square sourceSq(extMove.getSource());
-  Square targetSq(extMove.getTarget());
-  Piece movingPiece = Pawn;
-  Piece capturedPiece = Pawn;
-  Piece promotionPiece = Pawn;
-  bool capturing = false;
-  bool promoting = false;
-  bool doublePushing = false;
-  bool enPassanting = false;
-  int enPassantTargetFile = -1;
-  bool castling = false;
-  bool castlingDirection = false;
-
-  const BitBoard sourceBB(1LL << sourceSq);
+  const Square sourceSq(extMove.getSource());
+  const Square targetSq(extMove.getTarget());
   const BitBoard targetBB(1LL << targetSq);
+  const Piece movingPiece(EMPTY != _mailbox[sourceSq] ? getPieceAt(sourceSq)
+                                                      : Pawn);
+  const bool capturing(EMPTY != _mailbox[targetSq]);
 
-  bool sourceDirtied = !(_dirty & sourceBB);
-  bool targetDirtied = !(_dirty & targetBB);
-
-  for (size_t i = 0; i < 6; ++i) {
-    if (_pieces[i] & sourceBB) movingPiece = Piece(i);
-    if (_pieces[i] & targetBB) {
-      capturedPiece = Piece(i);
-      capturing = true;
-    }
-  }
+  Move move(Move::base(movingPiece, sourceSq, targetSq).withDirtied(_dirty));
+  if (capturing) move = move.withCapture(getPieceAt(targetSq));
 
   if (movingPiece == Pawn) {
     const int diff = sourceSq - targetSq;
-    if (abs(diff) == 16) {
-      doublePushing = true;
-      const int file = sourceSq & 7;
-      enPassantTargetFile = file;
-    } else if (targetBB & 0xFF000000000000FF) {
-      promoting = true;
-      promotionPiece = extMove.getPromotionPiece();
-    } else if (((diff & 1) == 1) && !capturing) {
-      enPassanting = true;
-      capturing = true;
-      capturedPiece = Pawn;
-    }
+    if (abs(diff) == 16)
+      move = move.withDoublePush();
+    else if (targetBB & 0xFF000000000000FF)
+      move = move.withPromotion(extMove.getPromotionPiece());
+    else if (((diff & 1) == 1) && !capturing)
+      move = move.withEnPassant();
   }
 
   if (movingPiece == King) {
     const int diff = sourceSq - targetSq;
-    if (2 == diff) {
-      castling = true;
-      castlingDirection = true;
-    } else if (-2 == diff) {
-      castling = true;
-      castlingDirection = false;
-    }
+    if (2 == diff)
+      move = move.withCastling(true);
+    else if (-2 == diff)
+      move = move.withCastling(false);
   }
 
   _moves.clear();
+  _status.clear();
+  _status.push(Status());
   int temp = _draw100Counter.top();
   _draw100Counter.clear();
   _draw100Counter.push(temp);
 
-  applyMove(Move(sourceSq, targetSq, movingPiece, capturedPiece, promotionPiece,
-                 promoting, capturing, doublePushing, enPassanting,
-                 enPassantTargetFile, castling, castlingDirection,
-                 sourceDirtied, targetDirtied));
+  applyMove(move);
 }
 
 void Board::applyMove(const Move move) {
+  if (White == _toMove)
+    applyMove<White>(move);
+  else
+    applyMove<Black>(move);
+}
+
+template <Color color>
+void Board::applyMove(const Move move) {
+  typedef Side<color> Us;
   if (_terminalState != Running) return;
 
   _moves.push(move);
+  Status& status(_status.grow());  // rather than writing out a whole one
+  status.safetyKnown = status.unsafeKnown = false;
+  status.previousEP = _epAvailable;
   if (move.getCapturing() || move.getEnPassanting() ||
       (move.getMovingPiece() == Pawn))
     _draw100Counter.push(0);
   else
     _draw100Counter.push(_draw100Counter.top() + 1);
 
-  _hash ^= Zobrist::GetInstance().getBlackToMove();
-  if (_epAvailable != -1) {
-    _hash ^= Zobrist::GetInstance().getEPFile(_epAvailable);
-    _epAvailable = -1;
-  }
+  _hash = getHashAfter<color>(move);
+  _pawnHash ^= getPawnHashDelta<color>(move);
+  _epAvailable = -1;
 
   const Square sourceSq(move.getSource());
   const Square targetSq(move.getTarget());
@@ -226,102 +233,165 @@ void Board::applyMove(const Move move) {
   const BitBoard target(1LL << targetSq);
   const Piece movingPiece(move.getMovingPiece());
 
-  Color movingColor = _toMove;
-  Color targetColor = Color(1 - _toMove);
-  _toMove = targetColor;
+  _toMove = Us::OTHER;
 
   _pieces[movingPiece] &= ~source;
   _pieces[movingPiece] |= target;
-  _colors[movingColor] &= ~source;
-  _colors[movingColor] |= target;
+  _colors[color] &= ~source;
+  _colors[color] |= target;
   _dirty |= source;
   _dirty |= target;
-  _hash ^=
-      Zobrist::GetInstance().getZobrist(movingColor, movingPiece, sourceSq);
-  _hash ^=
-      Zobrist::GetInstance().getZobrist(movingColor, movingPiece, targetSq);
+  _mailbox[sourceSq] = EMPTY;
+  _mailbox[targetSq] = move.getPromoting() ? move.getPromotionPiece()
+                                           : movingPiece;
 
   if (move.getEnPassanting()) {
-    BitBoard realTargetBB;
-    Square realTargetSq;
-    if (White == movingColor) {
-      realTargetBB = target >> 8;
-      realTargetSq = targetSq - 8;
-    } else {
-      realTargetBB = target << 8;
-      realTargetSq = targetSq + 8;
-    }
-    _colors[targetColor] &= ~realTargetBB;
+    const BitBoard realTargetBB(shift<-Us::FORWARD>(target));
+    _mailbox[targetSq - Us::FORWARD] = EMPTY;
+    _colors[Us::OTHER] &= ~realTargetBB;
     _pieces[Pawn] &= ~realTargetBB;
-    _hash ^= Zobrist::GetInstance().getZobrist(targetColor, Pawn, realTargetSq);
+    _materialKey -= MaterialTable::getDelta(Us::OTHER, Pawn);
   } else if (move.getCapturing()) {
     const Piece capturedPiece(move.getCapturedPiece());
     if (capturedPiece != movingPiece) _pieces[capturedPiece] &= ~target;
-    _colors[targetColor] &= ~target;
-    _hash ^=
-        Zobrist::GetInstance().getZobrist(targetColor, capturedPiece, targetSq);
+    _colors[Us::OTHER] &= ~target;
+    _materialKey -= MaterialTable::getDelta(Us::OTHER, capturedPiece);
   }
 
   if (move.getPromoting()) {
     const Piece promotionPiece(move.getPromotionPiece());
     _pieces[Pawn] &= ~target;
     _pieces[promotionPiece] |= target;
-    _hash ^= Zobrist::GetInstance().getZobrist(movingColor, Pawn, targetSq);
-    _hash ^= Zobrist::GetInstance().getZobrist(movingColor, promotionPiece,
-                                               targetSq);
+    _materialKey -= MaterialTable::getDelta(color, Pawn);
+    _materialKey += MaterialTable::getDelta(color, promotionPiece);
   }
 
   if (move.getDoublePushing()) {
-    int file(move.getEnPassantTargetFile());
-    _epAvailable = file;
-    _hash ^= Zobrist::GetInstance().getEPFile(file);
+    _epAvailable = move.getEnPassantTargetFile();
   }
 
   if (move.getCastling()) {
-    Square rookSource;
-    Square rookTarget;
-    if (White == movingColor) {
-      if (move.getCastlingDirection() == true) {
-        _hash ^= Zobrist::GetInstance().getWKCastle();
-        rookSource = 0;
-        rookTarget = 2;
-      } else {
-        _hash ^= Zobrist::GetInstance().getWQCastle();
-        rookSource = 7;
-        rookTarget = 4;
-      }
-    } else {
-      if (move.getCastlingDirection() == true) {
-        _hash ^= Zobrist::GetInstance().getBKCastle();
-        rookSource = 56;
-        rookTarget = 58;
-      } else {
-        _hash ^= Zobrist::GetInstance().getBQCastle();
-        rookSource = 63;
-        rookTarget = 60;
-      }
-    }
-    const BitBoard rookSourceBB(1LL << rookSource);
-    const BitBoard rookTargetBB(1LL << rookTarget);
+    // king side rooks go from h to f, queen side from a to d
+    const bool kingSide(move.getCastlingDirection());
+    const BitBoard rookSourceBB(1LL << (Us::HOME + (kingSide ? 0 : 7)));
+    const BitBoard rookTargetBB(1LL << (Us::HOME + (kingSide ? 2 : 4)));
     _pieces[Rook] &= ~rookSourceBB;
     _pieces[Rook] |= rookTargetBB;
-    _colors[movingColor] &= ~rookSourceBB;
-    _colors[movingColor] |= rookTargetBB;
+    _colors[color] &= ~rookSourceBB;
+    _colors[color] |= rookTargetBB;
     _dirty |= rookSourceBB;
-    _hash ^= Zobrist::GetInstance().getZobrist(movingColor, Rook, rookSource);
-    _hash ^= Zobrist::GetInstance().getZobrist(movingColor, Rook, rookTarget);
+    _mailbox[Us::HOME + (kingSide ? 0 : 7)] = EMPTY;
+    _mailbox[Us::HOME + (kingSide ? 2 : 4)] = Rook;
+  }
+}
+
+Board::Signature Board::getSignature() const {
+  Signature signature;
+  signature.pieces = _pieces;
+  signature.colors = _colors;
+  signature.castling = _dirty & 0x8900000000000089;
+  signature.epAvailable = _epAvailable;
+  signature.toMove = _toMove;
+  return signature;
+}
+
+bool Board::Signature::operator==(const Signature& rhs) const {
+  return pieces == rhs.pieces && colors == rhs.colors &&
+         castling == rhs.castling && epAvailable == rhs.epAvailable &&
+         toMove == rhs.toMove;
+}
+
+// The hash applyMove(move) will produce, available before the move is made
+// so the search can start fetching the child's transposition entry early.
+ZobristNumber Board::getHashAfter(const Move move) const {
+  if (White == _toMove) return getHashAfter<White>(move);
+  return getHashAfter<Black>(move);
+}
+
+template <Color color>
+ZobristNumber Board::getHashAfter(const Move move) const {
+  typedef Side<color> Us;
+  ZobristNumber hash(_hash ^ Zobrist::getBlackToMove());
+  if (_epAvailable != -1) hash ^= Zobrist::getEPFile(_epAvailable);
+
+  const Square sourceSq(move.getSource());
+  const Square targetSq(move.getTarget());
+  const Piece movingPiece(move.getMovingPiece());
+
+  hash ^= Zobrist::getZobrist<color>(movingPiece, sourceSq);
+  hash ^= Zobrist::getZobrist<color>(movingPiece, targetSq);
+
+  if (move.getEnPassanting()) {
+    hash ^= Zobrist::getZobrist<Us::OTHER>(Pawn, targetSq - Us::FORWARD);
+  } else if (move.getCapturing()) {
+    hash ^= Zobrist::getZobrist<Us::OTHER>(move.getCapturedPiece(), targetSq);
+  }
+
+  if (move.getPromoting()) {
+    hash ^= Zobrist::getZobrist<color>(Pawn, targetSq);
+    hash ^= Zobrist::getZobrist<color>(move.getPromotionPiece(), targetSq);
   }
+
+  if (move.getDoublePushing())
+    hash ^= Zobrist::getEPFile(move.getEnPassantTargetFile());
+
+  if (move.getCastling()) {
+    const bool kingSide(move.getCastlingDirection());
+    if (White == color)
+      hash ^= kingSide ? Zobrist::getWKCastle() : Zobrist::getWQCastle();
+    else
+      hash ^= kingSide ? Zobrist::getBKCastle() : Zobrist::getBQCastle();
+    hash ^= Zobrist::getZobrist<color>(Rook, Us::HOME + (kingSide ? 0 : 7));
+    hash ^= Zobrist::getZobrist<color>(Rook, Us::HOME + (kingSide ? 2 : 4));
+  }
+
+  return hash;
 }
 
+// Pawn placement alone, so moving pieces round a fixed pawn structure
+// keeps the key and the structure is only evaluated once.
+template <Color color>
+ZobristNumber Board::getPawnHashDelta(const Move move) const {
+  typedef Side<color> Us;
+  const Square targetSq(move.getTarget());
+  ZobristNumber delta(0);
+
+  if (Pawn == move.getMovingPiece()) {
+    delta ^= Zobrist::getZobrist<color>(Pawn, move.getSource());
+    if (!move.getPromoting())
+      delta ^= Zobrist::getZobrist<color>(Pawn, targetSq);
+  }
+
+  if (move.getEnPassanting()) {
+    delta ^= Zobrist::getZobrist<Us::OTHER>(Pawn, targetSq - Us::FORWARD);
+  } else if (move.getCapturing() && Pawn == move.getCapturedPiece()) {
+    delta ^= Zobrist::getZobrist<Us::OTHER>(Pawn, targetSq);
+  }
+
+  return delta;
+}
+
+void Board::unapplyMove(const Move move) {
+  if (White == _toMove)
+    unapplyMove<Black>(move);
+  else
+    unapplyMove<White>(move);
+}
+
+template <Color color>
 void Board::unapplyMove(const Move move) {
+  typedef Side<color> Us;
   _terminalState = Running;
 
   _moves.pop();
+  const int previousEP(_status.top().previousEP);
+  _status.pop();
   _draw100Counter.pop();
+  _pawnHash ^= getPawnHashDelta<color>(move);
 
-  _hash ^= Zobrist::GetInstance().getBlackToMove();
+  _hash ^= Zobrist::getBlackToMove();
   if (_epAvailable != -1) {
-    _hash ^= Zobrist::GetInstance().getEPFile(_epAvailable);
+    _hash ^= Zobrist::getEPFile(_epAvailable);
     _epAvailable = -1;
   }
 
@@ -331,40 +401,34 @@ void Board::unapplyMove(const Move move) {
   const BitBoard target(1LL << targetSq);
   const Piece movingPiece(move.getMovingPiece());
 
-  Color movingColor = Color(1 - _toMove);
-  Color targetColor = _toMove;
-  _toMove = movingColor;
+  _toMove = color;
 
   _pieces[movingPiece] |= source;
   _pieces[movingPiece] &= ~target;
-  _colors[_toMove] |= source;
-  _colors[_toMove] &= ~target;
+  _colors[color] |= source;
+  _colors[color] &= ~target;
   if (move.getSourceDirtied()) _dirty &= ~source;
   if (move.getTargetDirtied()) _dirty &= ~target;
-  _hash ^=
-      Zobrist::GetInstance().getZobrist(movingColor, movingPiece, targetSq);
-  _hash ^=
-      Zobrist::GetInstance().getZobrist(movingColor, movingPiece, sourceSq);
+  _mailbox[sourceSq] = movingPiece;
+  _mailbox[targetSq] = EMPTY;
+  if (move.getCapturing() && !move.getEnPassanting())
+    _mailbox[targetSq] = move.getCapturedPiece();
+  _hash ^= Zobrist::getZobrist<color>(movingPiece, targetSq);
+  _hash ^= Zobrist::getZobrist<color>(movingPiece, sourceSq);
 
   if (move.getEnPassanting()) {
-    BitBoard realTargetBB;
-    Square realTargetSq;
-    if (White == movingColor) {
-      realTargetBB = target >> 8;
-      realTargetSq = targetSq - 8;
-    } else {
-      realTargetBB = target << 8;
-      realTargetSq = targetSq + 8;
-    }
-    _colors[targetColor] |= realTargetBB;
+    const BitBoard realTargetBB(shift<-Us::FORWARD>(target));
+    _colors[Us::OTHER] |= realTargetBB;
     _pieces[Pawn] |= realTargetBB;
-    _hash ^= Zobrist::GetInstance().getZobrist(targetColor, Pawn, realTargetSq);
+    _mailbox[targetSq - Us::FORWARD] = Pawn;
+    _materialKey += MaterialTable::getDelta(Us::OTHER, Pawn);
+    _hash ^= Zobrist::getZobrist<Us::OTHER>(Pawn, targetSq - Us::FORWARD);
   } else if (move.getCapturing()) {
     const Piece capturedPiece(move.getCapturedPiece());
     _pieces[capturedPiece] |= target;
-    _colors[targetColor] |= target;
-    _hash ^=
-        Zobrist::GetInstance().getZobrist(targetColor, capturedPiece, targetSq);
+    _colors[Us::OTHER] |= target;
+    _materialKey += MaterialTable::getDelta(Us::OTHER, capturedPiece);
+    _hash ^= Zobrist::getZobrist<Us::OTHER>(capturedPiece, targetSq);
   }
 
   if (move.getPromoting()) {
@@ -373,76 +437,64 @@ void Board::unapplyMove(const Move move) {
       _pieces[promotionPiece] &= ~target;
     else if (promotionPiece != move.getCapturedPiece())
       _pieces[promotionPiece] &= ~target;
-    _hash ^= Zobrist::GetInstance().getZobrist(movingColor, Pawn, targetSq);
-    _hash ^= Zobrist::GetInstance().getZobrist(movingColor, promotionPiece,
-                                               targetSq);
+    _materialKey += MaterialTable::getDelta(color, Pawn);
+    _materialKey -= MaterialTable::getDelta(color, promotionPiece);
+    _hash ^= Zobrist::getZobrist<color>(Pawn, targetSq);
+    _hash ^= Zobrist::getZobrist<color>(promotionPiece, targetSq);
   }
 
-  size_t movesSize = _moves.size();
-  if (movesSize > 0) {
-    const Move& previousMove(_moves.top());
-    if (previousMove.getDoublePushing()) {
-      int file(previousMove.getEnPassantTargetFile());
-      _epAvailable = file;
-      _hash ^= Zobrist::GetInstance().getEPFile(file);
-    }
+  if (-1 != previousEP) {
+    _epAvailable = previousEP;
+    _hash ^= Zobrist::getEPFile(previousEP);
   }
 
   if (move.getCastling()) {
-    Square rookSource;
-    Square rookTarget;
-    if (White == _toMove) {
-      if (move.getCastlingDirection() == true) {
-        _hash ^= Zobrist::GetInstance().getWKCastle();
-        rookSource = 0;
-        rookTarget = 2;
-      } else {
-        _hash ^= Zobrist::GetInstance().getWQCastle();
-        rookSource = 7;
-        rookTarget = 4;
-      }
-    } else {
-      if (move.getCastlingDirection() == true) {
-        _hash ^= Zobrist::GetInstance().getBKCastle();
-        rookSource = 56;
-        rookTarget = 58;
-      } else {
-        _hash ^= Zobrist::GetInstance().getBQCastle();
-        rookSource = 63;
-        rookTarget = 60;
-      }
-    }
+    const bool kingSide(move.getCastlingDirection());
+    const Square rookSource(Us::HOME + (kingSide ? 0 : 7));
+    const Square rookTarget(Us::HOME + (kingSide ? 2 : 4));
+    if (White == color)
+      _hash ^= kingSide ? Zobrist::getWKCastle() : Zobrist::getWQCastle();
+    else
+      _hash ^= kingSide ? Zobrist::getBKCastle() : Zobrist::getBQCastle();
     const BitBoard rookSourceBB(1LL << rookSource);
     const BitBoard rookTargetBB(1LL << rookTarget);
     _pieces[Rook] |= rookSourceBB;
     _pieces[Rook] &= ~rookTargetBB;
-    _colors[_toMove] |= rookSourceBB;
-    _colors[_toMove] &= ~rookTargetBB;
+    _colors[color] |= rookSourceBB;
+    _colors[color] &= ~rookTargetBB;
     _dirty &= ~rookSourceBB;
-    _hash ^= Zobrist::GetInstance().getZobrist(movingColor, Rook, rookSource);
-    _hash ^= Zobrist::GetInstance().getZobrist(movingColor, Rook, rookTarget);
+    _mailbox[rookSource] = Rook;
+    _mailbox[rookTarget] = EMPTY;
+    _hash ^= Zobrist::getZobrist<color>(Rook, rookSource);
+    _hash ^= Zobrist::getZobrist<color>(Rook, rookTarget);
   }
 }
 
+// Kept in the status stack when color is the mover's.
 BitBoard Board::getUnsafe(const Color color) const {
-  const Color otherColor = Color(1 - color);
-
-  const BitBoard otherKing = _pieces[King] & _colors[otherColor];
-  const BitBoard otherBishopsQueens =
-      (_pieces[Bishop] | _pieces[Queen]) & _colors[otherColor];
-  const BitBoard otherRooksQueens =
-      (_pieces[Rook] | _pieces[Queen]) & _colors[otherColor];
-  const BitBoard otherKnights = _pieces[Knight] & _colors[otherColor];
-  const BitBoard otherPawns = _pieces[Pawn] & _colors[otherColor];
-  const BitBoard allPieces = _colors[White] | _colors[Black];
+  if (color == _toMove) {
+    Status& status(_status.top());
+    if (!status.unsafeKnown) {
+      status.unsafe = getAttacks(Color(1 - color));
+      status.unsafeKnown = true;
+    }
+    return status.unsafe;
+  }
+  return getAttacks(Color(1 - color));
+}
 
-  return Kings::GetInstance().getAttacksFrom(otherKing, 0LL) |
-         Bishops::GetInstance().getAttacksFrom(otherBishopsQueens, allPieces,
-                                               0LL) |
-         Rooks::GetInstance().getAttacksFrom(otherRooksQueens, allPieces, 0LL) |
-         Knights::GetInstance().getAttacksFrom(otherKnights, 0LL) |
-         Pawns::GetInstance().getAttacksFrom(otherPawns, 0xFFFFFFFFFFFFFFFF,
-                                             otherColor);
+BitBoard Board::getAttacks(const Color color) const {
+  const BitBoard bishopsQueens((_pieces[Bishop] | _pieces[Queen]) &
+                               _colors[color]);
+  const BitBoard rooksQueens((_pieces[Rook] | _pieces[Queen]) &
+                             _colors[color]);
+  const BitBoard allPieces(_colors[White] | _colors[Black]);
+
+  return Kings::getAttacksFrom(_pieces[King] & _colors[color], 0LL) |
+         Fills::getAttacks(rooksQueens, bishopsQueens, allPieces) |
+         Knights::getAttacksFrom(_pieces[Knight] & _colors[color], 0LL) |
+         Pawns::getAttacksFrom(_pieces[Pawn] & _colors[color],
+                               0xFFFFFFFFFFFFFFFF, color);
 }
 
 bool Board::isUnsafe(Square square, Color color) const {
@@ -452,290 +504,227 @@ bool Board::isUnsafe(Square square, Color color) const {
   const BitBoard allPieces = _colors[White] | _colors[Black];
 
   const BitBoard otherKing = _pieces[King] & _colors[otherColor];
-  if (otherKing & Kings::GetInstance().getAttacksFrom(square)) return true;
+  if (otherKing & Kings::getAttacksFrom(square)) return true;
 
   const BitBoard otherKnights = _pieces[Knight] & _colors[otherColor];
-  if (otherKnights & Knights::GetInstance().getAttacksFrom(square)) return true;
+  if (otherKnights & Knights::getAttacksFrom(square)) return true;
 
   const BitBoard otherPawns = _pieces[Pawn] & _colors[otherColor];
   if (otherPawns &
-      Pawns::GetInstance().getAttacksFrom(target, 0xFFFFFFFFFFFFFFFFLL, color))
+      Pawns::getAttacksFrom(target, 0xFFFFFFFFFFFFFFFFLL, color))
     return true;
 
   const BitBoard otherBishopsQueens =
       (_pieces[Bishop] | _pieces[Queen]) & _colors[otherColor];
   if (otherBishopsQueens &
-      Bishops::GetInstance().getAttacksFrom(target, allPieces, 0LL))
+      Bishops::getAttacksFrom(target, allPieces, 0LL))
     return true;
 
   const BitBoard otherRooksQueens =
       (_pieces[Rook] | _pieces[Queen]) & _colors[otherColor];
   if (otherRooksQueens &
-      Rooks::GetInstance().getAttacksFrom(target, allPieces, 0LL))
+      Rooks::getAttacksFrom(target, allPieces, 0LL))
     return true;
 
   return false;
 }
 
-void Board::getMoves(BitBoard movers,
-                     std::function<BitBoard(BitBoard)> targetGenerator,
-                     Piece movingPiece, bool doublePushing,
-                     bool enPassanting) const {
-  while (0LL != movers) {
-    const Square source(__builtin_ffsll(movers) - 1);
-    BitBoard sourceBoard(1LL << source);
-    movers &= ~(1LL << source);
-    BitBoard targets(targetGenerator(sourceBoard));
-    while (0LL != targets) {
-      Square target(__builtin_ffsll(targets) - 1);
-
-      targets &= ~(1LL << target);
-
-      BitBoard targetBoard(1LL << target);
-
-      bool dirtyingSource = !(sourceBoard & _dirty);
-      bool dirtyingTarget = !(targetBoard & _dirty);
-
-      Piece capturedPiece(Pawn);  // covers en passant
-      bool capturing((targetBoard & (_colors[White] | _colors[Black])) != 0LL);
-      if (enPassanting)
-        capturing = true;
-      else if (capturing) {
-        if (targetBoard & _pieces[Knight])
-          capturedPiece = Knight;
-        else if (targetBoard & _pieces[Pawn])
-          capturedPiece = Pawn;
-        else if (targetBoard & _pieces[Bishop])
-          capturedPiece = Bishop;
-        else if (targetBoard & _pieces[Rook])
-          capturedPiece = Rook;
-        else if (targetBoard & _pieces[Queen])
-          capturedPiece = Queen;
-        else if (targetBoard & _pieces[King])
-          capturedPiece = King;
-      }
+// Moves from sourceOf(target) to each of targets, which holds only empty
+// squares and the other side's pieces. What each capture takes comes
+// straight out of the mailbox.
+template <Color color, Piece piece, typename SourceOf>
+void Board::pushMoves(const BitBoard targets, const SourceOf sourceOf) const {
+  BitBoard quiet(targets & ~(_colors[White] | _colors[Black]));
+  while (0LL != quiet) {
+    const Square target(popLowestSquare(quiet));
+    pushMove<color, piece>(sourceOf(target), target, Pawn, false);
+  }
 
-      if (Pawn == movingPiece) {
-        if (targetBoard & 0xFF000000000000FFLL) {
-          _ms.push(Move(source, target, Pawn, capturedPiece, Queen, true,
-                        capturing, false, false, -1, false, false,
-                        dirtyingSource, dirtyingTarget));
-          _ms.push(Move(source, target, Pawn, capturedPiece, Rook, true,
-                        capturing, false, false, -1, false, false,
-                        dirtyingSource, dirtyingTarget));
-          _ms.push(Move(source, target, Pawn, capturedPiece, Bishop, true,
-                        capturing, false, false, -1, false, false,
-                        dirtyingSource, dirtyingTarget));
-          _ms.push(Move(source, target, Pawn, capturedPiece, Knight, true,
-                        capturing, false, false, -1, false, false,
-                        dirtyingSource, dirtyingTarget));
-        } else {
-          int enPassantFile = -1;
-          if (doublePushing) {
-            enPassantFile = source % 8;
-          }
-          _ms.push(Move(source, target, Pawn, capturedPiece, Pawn, false,
-                        capturing, doublePushing, enPassanting, enPassantFile,
-                        false, false, dirtyingSource, dirtyingTarget));
-        }
-
-      } else {
-        _ms.push(Move(source, target, movingPiece, capturedPiece, Pawn, false,
-                      capturing, false, false, -1, false, false, dirtyingSource,
-                      dirtyingTarget));
-      }
-    }
+  BitBoard captures(targets & _colors[Side<color>::OTHER]);
+  while (0LL != captures) {
+    const Square target(popLowestSquare(captures));
+    pushMove<color, piece>(sourceOf(target), target, getPieceAt(target), true);
   }
 }
 
-void Board::getKingMoves(const Color color) const {
-  BitBoard movers = _pieces[King] & _colors[color];
-  auto targetGenerator = [&](BitBoard mover) -> BitBoard {
-    return Kings::GetInstance().getAttacksFrom(mover, _colors[color]);
-  };
-
-  getMoves(movers, targetGenerator, King);
+template <Color color, Piece piece>
+void Board::pushMove(const Square source, const Square target,
+                     const Piece capturedPiece, const bool capturing) const {
+  Move move(Move::base(piece, source, target).withDirtied(_dirty));
+  if (capturing) move = move.withCapture(capturedPiece);
+  if (Pawn == piece && ((1LL << target) & Side<color>::LAST_RANK)) {
+    for (const Piece promotionPiece : {Queen, Rook, Bishop, Knight})
+      _ms.push(move.withPromotion(promotionPiece));
+    return;
+  }
+  _ms.push(move);
 }
 
-void Board::getQueenMoves(const Color color) const {
-  BitBoard movers = _pieces[Queen] & _colors[color];
-  Color otherColor = Color(1 - color);
-
-  auto targetGenerator = [&](BitBoard mover) -> BitBoard {
-    return Rooks::GetInstance().getAttacksFrom(mover, _colors[otherColor],
-                                               _colors[color]) |
-           Bishops::GetInstance().getAttacksFrom(mover, _colors[otherColor],
-                                                 _colors[color]);
-  };
-
-  getMoves(movers, targetGenerator, Queen);
+template <Color color, Piece piece>
+BitBoard Board::getTargetsFrom(const Square source) const {
+  const BitBoard enemies(_colors[Side<color>::OTHER]);
+  const BitBoard friends(_colors[color]);
+  switch (piece) {
+    case Queen:
+      return Rooks::getAttacksFrom(source, enemies, friends) |
+             Bishops::getAttacksFrom(source, enemies, friends);
+    case Bishop:
+      return Bishops::getAttacksFrom(source, enemies, friends);
+    case Rook:
+      return Rooks::getAttacksFrom(source, enemies, friends);
+    default:
+      return 0LL;
+  }
 }
 
-void Board::getBishopMoves(const Color color) const {
-  BitBoard movers = _pieces[Bishop] & _colors[color];
-  Color otherColor = Color(1 - color);
-
-  auto targetGenerator = [&](BitBoard mover) -> BitBoard {
-    return Bishops::GetInstance().getAttacksFrom(mover, _colors[otherColor],
-                                                 _colors[color]);
-    ;
-  };
-
-  getMoves(movers, targetGenerator, Bishop);
+// A pinned slider keeps to the line through its king.
+template <Color color, Piece piece>
+void Board::getPieceMoves(const KingSafety& safety) const {
+  BitBoard movers = _pieces[piece] & _colors[color];
+  while (0LL != movers) {
+    const Square source(popLowestSquare(movers));
+    BitBoard targets(getTargetsFrom<color, piece>(source) & safety.evasions);
+    if (safety.pinned & (1LL << source))
+      targets &= Lines::getLine(safety.king, source);
+    pushMoves<color, piece>(targets, [source](Square) { return source; });
+  }
 }
 
-void Board::getKnightMoves(const Color color) const {
-  BitBoard movers = _pieces[Knight] & _colors[color];
-
-  auto targetGenerator = [&](BitBoard mover) -> BitBoard {
-    return Knights::GetInstance().getAttacksFrom(mover, _colors[color]);
-  };
-
-  getMoves(movers, targetGenerator, Knight);
+// Each target is tested without the king on the board, so it cannot hide
+// behind itself from a slider.
+template <Color color>
+void Board::getKingMoves(const KingSafety& safety) const {
+  const Square king(safety.king);
+  const BitBoard occupied((_colors[White] | _colors[Black]) ^ (1LL << king));
+  BitBoard targets(Kings::getAttacksFrom(king) & ~_colors[color]);
+  BitBoard safe(0LL);
+  while (0LL != targets) {
+    const Square target(popLowestSquare(targets));
+    if (!getAttackersOf<color>(target, occupied)) safe |= 1LL << target;
+  }
+  pushMoves<color, King>(safe, [king](Square) { return king; });
 }
 
-void Board::getRookMoves(const Color color) const {
-  BitBoard movers = _pieces[Rook] & _colors[color];
-  Color otherColor = Color(1 - color);
+namespace {
 
-  auto targetGenerator = [&](BitBoard mover) -> BitBoard {
-    return Rooks::GetInstance().getAttacksFrom(mover, _colors[otherColor],
-                                               _colors[color]);
-  };
-
-  getMoves(movers, targetGenerator, Rook);
+template <int delta>
+Square shiftedFrom(const Square target) {
+  return target - delta;
 }
-
-void Board::getPawnMoves(const Color color) const {
-  BitBoard movers = _pieces[Pawn] & _colors[color];
-  Color otherColor = Color(1 - color);
-  BitBoard targets = _colors[otherColor];
-
-  if (_epAvailable > -1) {
-    Square epSquare(40 + _epAvailable);
-    if (Black == color) epSquare -= 24;
-
-    targets |= (1LL << epSquare);
-  }
-
-  auto targetGenerator = [&](BitBoard mover) -> BitBoard {
-    BitBoard blockers(_colors[color] | _colors[otherColor]);
-    return Pawns::GetInstance().getMovesFrom(mover, blockers, color);
-  };
-
-  getMoves(movers, targetGenerator, Pawn);
 }
 
-void Board::getPawnAttacks(const Color color) const {
-  BitBoard movers = _pieces[Pawn] & _colors[color];
-  Color otherColor = Color(1 - color);
-  BitBoard targets = _colors[otherColor];
-
-  if (_epAvailable > -1) {
-    Square epSquare(40 + _epAvailable);
-    if (Black == color) epSquare -= 24;
+// Set-wise: each of the eight jumps moves every knight at once, and the
+// source of a target is the jump back.
+// A pinned knight can never stay on its line, so it does not move at all.
+template <Color color>
+void Board::getKnightMoves(const KingSafety& safety) const {
+  const BitBoard knights(_pieces[Knight] & _colors[color] & ~safety.pinned);
+  const BitBoard open(~_colors[color] & safety.evasions);
+  pushMoves<color, Knight>(shift<17>(knights & notAFile) & open,
+                           shiftedFrom<17>);
+  pushMoves<color, Knight>(shift<15>(knights & notHFile) & open,
+                           shiftedFrom<15>);
+  pushMoves<color, Knight>(shift<10>(knights & notABFile) & open,
+                           shiftedFrom<10>);
+  pushMoves<color, Knight>(shift<6>(knights & notGHFile) & open,
+                           shiftedFrom<6>);
+  pushMoves<color, Knight>(shift<-6>(knights & notABFile) & open,
+                           shiftedFrom<-6>);
+  pushMoves<color, Knight>(shift<-10>(knights & notGHFile) & open,
+                           shiftedFrom<-10>);
+  pushMoves<color, Knight>(shift<-15>(knights & notAFile) & open,
+                           shiftedFrom<-15>);
+  pushMoves<color, Knight>(shift<-17>(knights & notHFile) & open,
+                           shiftedFrom<-17>);
+}
 
-    targets |= (1LL << epSquare);
+// Set-wise as well: pushes, double pushes and captures to either side are
+// each one shift of all the Pawns:: Only targets in allowed are kept, which
+// is how checks and pins reach them. Promotions come out of pushMove().
+template <Color color>
+void Board::getPawnMoves(const BitBoard pawns, const BitBoard allowed) const {
+  typedef Side<color> Us;
+  const BitBoard empty(~(_colors[White] | _colors[Black]));
+  const BitBoard enemies(_colors[Us::OTHER] & allowed);
+
+  const BitBoard pushes(shift<Us::FORWARD>(pawns) & empty);
+  BitBoard doubles(shift<Us::FORWARD>(pushes & Us::PUSHED_RANK) & empty &
+                   allowed);
+  const BitBoard westCaptures(shift<Us::WEST>(pawns & notAFile));
+  const BitBoard eastCaptures(shift<Us::EAST>(pawns & notHFile));
+
+  pushMoves<color, Pawn>(pushes & allowed, shiftedFrom<Us::FORWARD>);
+  pushMoves<color, Pawn>(westCaptures & enemies, shiftedFrom<Us::WEST>);
+  pushMoves<color, Pawn>(eastCaptures & enemies, shiftedFrom<Us::EAST>);
+
+  while (0LL != doubles) {
+    const Square target(popLowestSquare(doubles));
+    const Square source(target - 2 * Us::FORWARD);
+    _ms.push(Move::base(Pawn, source, target).withDoublePush().withDirtied(
+        _dirty));
   }
-
-  auto targetGenerator = [&](BitBoard mover) -> BitBoard {
-    return Pawns::GetInstance().getAttacksFrom(mover, targets, color);
-  };
-
-  getMoves(movers, targetGenerator, Pawn);
 }
 
-void Board::getPawnEnPassants(const Color color) const {
+// En passant takes two pawns off one rank at once, which pins cannot
+// describe, so each capture is checked against the position it leaves.
+template <Color color>
+void Board::getEnPassants(const KingSafety& safety) const {
+  typedef Side<color> Us;
   if (-1 == _epAvailable) return;
-
-  BitBoard movers(_pieces[Pawn] & _colors[color]);
-  Square epSquare(40 + _epAvailable);
-  if (White == color) {
-    movers &= 0x00000000FF000000;
-  } else {
-    movers &= 0x000000FF00000000;
-    epSquare -= 24;
+  const Square passant(Us::PASSANT + _epAvailable);
+  const BitBoard captured(1LL << (passant - Us::FORWARD));
+  BitBoard capturers(Pawns::getAttacksFrom<Us::OTHER>(
+      1LL << passant, _pieces[Pawn] & _colors[color]));
+  while (0LL != capturers) {
+    const Square source(popLowestSquare(capturers));
+    const BitBoard occupied(
+        ((_colors[White] | _colors[Black]) ^ (1LL << source) ^ captured) |
+        (1LL << passant));
+    if (getAttackersOf<color>(safety.king, occupied) & ~captured) continue;
+    _ms.push(Move::base(Pawn, source, passant).withEnPassant().withDirtied(
+        _dirty));
   }
-
-  BitBoard target(1LL << epSquare);
-
-  auto targetGenerator = [&](BitBoard mover) -> BitBoard {
-    return Pawns::GetInstance().getAttacksFrom(mover, target, color);
-  };
-
-  getMoves(movers, targetGenerator, Pawn, false, true);
-}
-
-void Board::getPawnDoublePushes(const Color color) const {
-  BitBoard movers = _pieces[Pawn] & _colors[color];
-  Color otherColor = Color(1 - color);
-
-  auto targetGenerator = [&](BitBoard mover) -> BitBoard {
-    BitBoard blockers(_colors[color] | _colors[otherColor]);
-    return Pawns::GetInstance().getDoublePushesFrom(mover, blockers, color);
-  };
-
-  getMoves(movers, targetGenerator, Pawn, true, false);
 }
 
-void Board::getCastlingMoves(const Color color) const {
-  if (White == color) {
-    if (WKingMoved() || (WKRookMoved() && WQRookMoved()))
-      return;  // nobody to castle with
-
-    Square kingLoc(3);
-    if (isUnsafe(kingLoc, White)) return;
-
-    const BitBoard unsafe(getUnsafe(color));
-    const BitBoard blocked(_colors[Black] | _colors[White]);
-    const BitBoard noGo(blocked | unsafe);
-    if (!WKRookMoved()) {
-      const BitBoard path(6LL);
-      if ((path & noGo) == 0LL) {
-        _ms.push(Move(kingLoc, kingLoc - 2, King, Pawn, Pawn, false, false,
-                      false, false, -1, true, true, true, false));
-      }
+// The king may not castle through or into check, nor out of it, which
+// getLegalMoves() has already ruled out. The rook's path only needs to be
+// empty.
+template <Color color>
+void Board::getCastlingMoves() const {
+  typedef Side<color> Us;
+  const BitBoard kingHome(1LL << (Us::HOME + 3));
+  const BitBoard kingRook(1LL << Us::HOME);
+  const BitBoard queenRook(1LL << (Us::HOME + 7));
+  if ((_dirty & kingHome) || ((_dirty & kingRook) && (_dirty & queenRook)))
+    return;  // nobody to castle with
+
+  const Square kingLoc(Us::HOME + 3);
+  const BitBoard unsafe(getUnsafe(color));
+  const BitBoard blocked(_colors[Black] | _colors[White]);
+  const BitBoard noGo(blocked | unsafe);
+  if (!(_dirty & kingRook)) {
+    const BitBoard path(6LL << Us::HOME);
+    if ((path & noGo) == 0LL) {
+      _ms.push(Move::base(King, kingLoc, kingLoc - 2).withCastling(true));
     }
-    if (!WQRookMoved()) {
-      const BitBoard rookPath(112LL);
-      const BitBoard kingPath(48LL);
-      if ((kingPath & noGo) == 0LL && (rookPath & blocked) == 0LL) {
-        _ms.push(Move(kingLoc, kingLoc + 2, King, Pawn, Pawn, false, false,
-                      false, false, -1, true, false, true, false));
-      }
-    }
-  } else  // Black == color
-  {
-    if (BKingMoved() || (BKRookMoved() && BQRookMoved()))
-      return;  // nobody  to castle with
-
-    Square kingLoc(59);
-    if (isUnsafe(kingLoc, Black)) return;
-
-    const BitBoard unsafe(getUnsafe(color));
-    const BitBoard blocked(_colors[Black] | _colors[White]);
-    const BitBoard noGo(blocked | unsafe);
-    if (!BKRookMoved()) {
-      const BitBoard path(6LL << 56);
-      if ((path & noGo) == 0LL) {
-        _ms.push(Move(kingLoc, kingLoc - 2, King, Pawn, Pawn, false, false,
-                      false, false, -1, true, true, true, false));
-      }
-    }
-    if (!BQRookMoved()) {
-      const BitBoard rookPath(112LL << 56);
-      const BitBoard kingPath(48LL << 56);
-      if ((kingPath & noGo) == 0LL && (rookPath & blocked) == 0LL) {
-        _ms.push(Move(kingLoc, kingLoc + 2, King, Pawn, Pawn, false, false,
-                      false, false, -1, true, false, true, false));
-      }
+  }
+  if (!(_dirty & queenRook)) {
+    const BitBoard rookPath(112LL << Us::HOME);
+    const BitBoard kingPath(48LL << Us::HOME);
+    if ((kingPath & noGo) == 0LL && (rookPath & blocked) == 0LL) {
+      _ms.push(Move::base(King, kingLoc, kingLoc + 2).withCastling(false));
     }
   }
 }
 
+// The mover's checkers come from the status stack.
 bool Board::inCheck(const Color color) const {
   BitBoard kingBoard(_pieces[King] & _colors[color]);
-  Square kingSquare(__builtin_ffsll(kingBoard) - 1);
+  if (color == _toMove && kingBoard) {
+    return 0LL != ((White == color) ? getSafety<White>().checkers
+                                    : getSafety<Black>().checkers);
+  }
+  Square kingSquare(getLowestSquare(kingBoard));
   return isUnsafe(kingSquare, color);
 }
 
@@ -773,29 +762,108 @@ void Board::getMoves(const Color color, const bool checkCheckmate) {
     return;
   }
 
-  getCastlingMoves(color);
-  getKingMoves(color);
-  getQueenMoves(color);
-  getBishopMoves(color);
-  getKnightMoves(color);
-  getRookMoves(color);
-  getPawnMoves(color);
-  getPawnDoublePushes(color);
-  getPawnAttacks(color);
-  getPawnEnPassants(color);
-
-  if (!checkCheckmate) {
-    _ms.popTo(std::remove_if(_ms.begin(), _ms.end(),
-                             [this, color](Move& move) -> bool {
-      applyMove(move);
-      bool bad = inCheck(color);
-      unapplyMove(move);
-      return bad;
-    }));
-  }
+  getLegalMoves(color);
   if (_ms.size() == 0) _terminalState = Draw;
 }
 
+// No terminal checks; an empty list is mate or stalemate.
+void Board::getLegalMoves(const Color color) const {
+  if (White == color)
+    getLegalMoves<White>();
+  else
+    getLegalMoves<Black>();
+}
+
+// The enemy pieces that attack square, sliders seen through occupied
+// rather than the board as it stands.
+template <Color color>
+BitBoard Board::getAttackersOf(const Square square,
+                               const BitBoard occupied) const {
+  const BitBoard straight(_pieces[Rook] | _pieces[Queen]);
+  const BitBoard diagonal(_pieces[Bishop] | _pieces[Queen]);
+  return _colors[Side<color>::OTHER] &
+         ((Kings::getAttacksFrom(square) & _pieces[King]) |
+          (Knights::getAttacksFrom(square) & _pieces[Knight]) |
+          Pawns::getAttacksFrom<color>(1LL << square,
+                                                     _pieces[Pawn]) |
+          (Rooks::getAttacksFrom(square, occupied, 0LL) &
+           straight) |
+          (Bishops::getAttacksFrom(square, occupied, 0LL) &
+           diagonal));
+}
+
+// A piece is pinned when it is the only thing between its king and an
+// enemy slider that looks down that line.
+template <Color color>
+Board::KingSafety Board::getKingSafety() const {
+  const BitBoard occupied(_colors[White] | _colors[Black]);
+  const BitBoard enemies(_colors[Side<color>::OTHER]);
+
+  KingSafety safety;
+  safety.king = getLowestSquare(_pieces[King] & _colors[color]);
+  safety.checkers = getAttackersOf<color>(safety.king, occupied);
+  safety.pinned = 0LL;
+  BitBoard snipers(
+      enemies &
+      ((Rooks::getAttacksFrom(safety.king, 0LL, 0LL) &
+        (_pieces[Rook] | _pieces[Queen])) |
+       (Bishops::getAttacksFrom(safety.king, 0LL, 0LL) &
+        (_pieces[Bishop] | _pieces[Queen]))));
+  while (0LL != snipers) {
+    const Square sniper(popLowestSquare(snipers));
+    const BitBoard blockers(Lines::getBetween(safety.king, sniper) & occupied);
+    if (blockers && !(blockers & (blockers - 1)))
+      safety.pinned |= blockers & _colors[color];
+  }
+
+  safety.evasions = ~0LL;
+  if (safety.checkers) {
+    const Square checker(getLowestSquare(safety.checkers));
+    safety.evasions =
+        safety.checkers | Lines::getBetween(safety.king, checker);
+  }
+  return safety;
+}
+
+template <Color color>
+const Board::KingSafety& Board::getSafety() const {
+  Status& status(_status.top());
+  if (!status.safetyKnown) {
+    status.safety = getKingSafety<color>();
+    status.safetyKnown = true;
+  }
+  return status.safety;
+}
+
+// In double check only the king moves. Pinned pawns go one at a time,
+// since each has its own line.
+template <Color color>
+void Board::getLegalMoves() const {
+  if (0LL == (_pieces[King] & _colors[color])) return;  // already lost
+
+  const KingSafety safety((color == _toMove) ? getSafety<color>()
+                                              : getKingSafety<color>());
+  if (!safety.checkers) getCastlingMoves<color>();
+  getKingMoves<color>(safety);
+  if (safety.checkers & (safety.checkers - 1)) return;
+
+  getPieceMoves<color, Queen>(safety);
+  getPieceMoves<color, Bishop>(safety);
+  getKnightMoves<color>(safety);
+  getPieceMoves<color, Rook>(safety);
+
+  const BitBoard pawns(_pieces[Pawn] & _colors[color]);
+  getPawnMoves<color>(pawns & ~safety.pinned, safety.evasions);
+  BitBoard pinned(pawns & safety.pinned);
+  while (0LL != pinned) {
+    const Square source(popLowestSquare(pinned));
+    getPawnMoves<color>(
+        1LL << source,
+        safety.evasions & Lines::getLine(safety.king, source));
+  }
+  getEnPassants<color>(safety);
+}
+
 bool Board::isDraw100() {
   if (100 == _draw100Counter.top()) {
     _terminalState = Draw;
@@ -804,6 +872,47 @@ bool Board::isDraw100() {
   return false;
 }
 
+// Neither side can mate whatever is played, so there is nothing to search.
+// The material table covers all but a bishop each on squares of one
+// colour, which takes the board.
+bool Board::isInsufficientMaterial() const {
+  static const MaterialKey BISHOP_EACH(
+      MaterialTable::getDelta(White, King) +
+      MaterialTable::getDelta(White, Bishop) +
+      MaterialTable::getDelta(Black, King) +
+      MaterialTable::getDelta(Black, Bishop));
+  if (BISHOP_EACH == _materialKey)
+    return !(_pieces[Bishop] & lightSquares) ||
+           !(_pieces[Bishop] & ~lightSquares);
+  return MaterialTable::Evaluator::Draw ==
+         MaterialTable::GetInstance().getEntry(_materialKey).evaluator;
+}
+
+// Whether the side to move has a reversible move back into a position that
+// history, whose latest key is this one, already holds twice. The move
+// shows up as the key difference to a position an odd number of plies
+// back, provided nothing stands in its way.
+bool Board::hasUpcomingRepetition(const ThreefoldTable& history) const {
+  const int reversible(getReversiblePlies());
+  if (reversible < 3) return false;
+
+  Cuckoo& cuckoo(Cuckoo::GetInstance());
+  const BitBoard occupied(_colors[White] | _colors[Black]);
+  for (int back = 3; back <= reversible && size_t(back) < history.size();
+       back += 2) {
+    const ZobristNumber key(history.getKey(back));
+    Square source, target;
+    if (!cuckoo.getMove(_hash ^ key, source, target)) continue;
+    if (Lines::getBetween(source, target) & occupied) continue;
+
+    const BitBoard ends((1LL << source) | (1LL << target));
+    const BitBoard mover(ends & occupied);
+    if (!(mover & _colors[_toMove]) || (mover & (mover - 1))) continue;
+    if (history.addWouldTrigger(key, reversible + 1)) return true;
+  }
+  return false;
+}
+
 Board Board::initial() {
   Board result;
   result._pieces[Pawn] = 0x00FF00000000FF00;
@@ -815,23 +924,56 @@ Board Board::initial() {
   result._colors[Black] = 0xFFFF000000000000;
   result._colors[White] = 0x000000000000FFFF;
   result._toMove = White;
-
-  result._hash = 0LL;
+  result.computeKeys();
 
   return result;
 }
 
+// From scratch, for a position that was set up rather than played into.
+// Castling keys are only folded in by the castling move itself, so they
+// are left out here as well. The mailbox is filled in on the way, and the
+// status stack starts over with nothing known.
+void Board::computeKeys() {
+  _hash = 0LL;
+  _pawnHash = 0LL;
+  _materialKey = 0LL;
+  _mailbox.fill(EMPTY);
+  _status.clear();
+  _status.push(Status());
+  for (int color = White; color <= Black; ++color) {
+    for (int piece = 0; piece < 6; ++piece) {
+      BitBoard dudes(_pieces[piece] & _colors[color]);
+      while (0LL != dudes) {
+        const Square location(popLowestSquare(dudes));
+        _mailbox[location] = piece;
+        const ZobristNumber key(
+            Zobrist::getZobrist(Color(color), Piece(piece), location));
+        _hash ^= key;
+        if (Pawn == piece) _pawnHash ^= key;
+        _materialKey += MaterialTable::getDelta(Color(color), Piece(piece));
+      }
+    }
+  }
+  if (Black == _toMove) _hash ^= Zobrist::getBlackToMove();
+  if (_epAvailable != -1) _hash ^= Zobrist::getEPFile(_epAvailable);
+}
+
 uint64_t Board::perft(const int depth) {
   uint64_t result = 0;
 
   if (0 == depth) return 1;
 
+  // Every generated move is legal, so the last ply is just a count.
   _ms.newFrame();
-  getMoves(_toMove);
-  for (const Move& m : _ms) {
-    applyMove(m);
-    result += perft(depth - 1);
-    unapplyMove(m);
+  getLegalMoves(_toMove);
+  if (1 == depth) {
+    result = _ms.size();
+  } else {
+    for (const Move& m : _ms) {
+      applyMove(m);
+      result += perft(depth - 1);
+      unapplyMove(m);
+    }
   }
   _ms.popFrame();
 
@@ -884,16 +1026,11 @@ Board Board::parseEPD(std::istream& in) {
   if (std::string::npos != castling.find('K')) clean |= 0x0000000000000009;
   result._dirty = ~clean;
 
-  // en passant
-  if (std::string::npos != castling.find('a')) result._epAvailable = 7;
-  if (std::string::npos != castling.find('b')) result._epAvailable = 6;
-  if (std::string::npos != castling.find('c')) result._epAvailable = 5;
-  if (std::string::npos != castling.find('d')) result._epAvailable = 4;
-  if (std::string::npos != castling.find('e')) result._epAvailable = 3;
-  if (std::string::npos != castling.find('f')) result._epAvailable = 2;
-  if (std::string::npos != castling.find('g')) result._epAvailable = 1;
-  if (std::string::npos != castling.find('h')) result._epAvailable = 0;
+  // en passant, files counted from h
+  if (enPassant.size() == 2 && enPassant[0] >= 'a' && enPassant[0] <= 'h')
+    result._epAvailable = 'h' - enPassant[0];
 
+  result.computeKeys();
   return result;
 }
 
@@ -954,19 +1091,9 @@ bool Board::parse(const char square, Color& color, Piece& piece) {
 
 std::ostream& operator<<(std::ostream& lhs, const Board& rhs) {
   auto charAt = [&](size_t i) -> char {
-    if (rhs._pieces[Knight] & rhs._colors[White] & (1LL << i)) return 'N';
-    if (rhs._pieces[Knight] & rhs._colors[Black] & (1LL << i)) return 'n';
-    if (rhs._pieces[Pawn] & rhs._colors[White] & (1LL << i)) return 'P';
-    if (rhs._pieces[Pawn] & rhs._colors[Black] & (1LL << i)) return 'p';
-    if (rhs._pieces[Rook] & rhs._colors[White] & (1LL << i)) return 'R';
-    if (rhs._pieces[Rook] & rhs._colors[Black] & (1LL << i)) return 'r';
-    if (rhs._pieces[Bishop] & rhs._colors[White] & (1LL << i)) return 'B';
-    if (rhs._pieces[Bishop] & rhs._colors[Black] & (1LL << i)) return 'b';
-    if (rhs._pieces[Queen] & rhs._colors[White] & (1LL << i)) return 'Q';
-    if (rhs._pieces[Queen] & rhs._colors[Black] & (1LL << i)) return 'q';
-    if (rhs._pieces[King] & rhs._colors[White] & (1LL << i)) return 'K';
-    if (rhs._pieces[King] & rhs._colors[Black] & (1LL << i)) return 'k';
-    return '.';
+    if (Board::EMPTY == rhs._mailbox[i]) return '.';
+    const char symbol("NRBQKP"[rhs._mailbox[i]]);
+    return (rhs._colors[White] & (1LL << i)) ? symbol : symbol - 'A' + 'a';
   };
 
   for (int i = 63; i > -1; --i) {
@@ -7,13 +7,13 @@
 
 #include <array>
 #include <iostream>
-#include <functional>
 
 #include "BitBoard.h"
 #include "BNStack.h"
 #include "Enums.h"
 #include "FramedStack.h"
 #include "Move.h"
+#include "ThreefoldTable.h"
 
 namespace BixNix {
 
@@ -25,6 +25,18 @@ class Board {
 
   typedef FramedStack<Move, 750, 100> MoveStack;
 
+  // All a position's hash stands for, to confirm that two positions with
+  // the same hash really are the same.
+  struct Signature {
+    std::array<BitBoard, 6> pieces;
+    std::array<BitBoard, 2> colors;
+    BitBoard castling;  // which king and rook home squares were dirtied
+    int32_t epAvailable;
+    uint32_t toMove;
+
+    bool operator==(const Signature& rhs) const;
+  };
+
   Board();
   Board(const Board& that);
   Board& operator=(const Board& that);
@@ -35,11 +47,22 @@ class Board {
   void debug() const;
 
   void getMoves(const Color color, const bool checkCheckmate = true);
+  // Only legal moves: checks and pins are worked out once for the position
+  // rather than by trying each move.
+  void getLegalMoves(const Color color) const;
 
   void applyExternalMove(const Move extMove);
 
   Color getMover() const { return _toMove; }
   ZobristNumber getHash() const { return _hash; }
+  ZobristNumber getHashAfter(const Move move) const;
+  ZobristNumber getPawnHash() const { return _pawnHash; }
+  MaterialKey getMaterialKey() const { return _materialKey; }
+  Signature getSignature() const;
+  // Only meaningful for an occupied square; the colour is in the bitboards.
+  Piece getPieceAt(const Square square) const {
+    return Piece(_mailbox[square]);
+  }
   TerminalState getTerminalState() const { return _terminalState; }
   uint64_t perft(const int depth);
 
@@ -47,6 +70,9 @@ class Board {
   static Board parseEPD(std::istream& inFile);
 
   bool isDraw100();
+  int getReversiblePlies() const { return _draw100Counter.top(); }
+  bool isInsufficientMaterial() const;
+  bool hasUpcomingRepetition(const ThreefoldTable& history) const;
   bool inCheck(const Color color) const;
   bool inCheckmate(const Color color);
   bool WKingMoved() const { return _dirty & (1L << 3); }
@@ -61,26 +87,78 @@ class Board {
 
  private:
   BitBoard getUnsafe(Color color) const;
+  // every square color's pieces attack, the board as it stands
+  BitBoard getAttacks(Color color) const;
   bool isUnsafe(Square square, Color color) const;
 
-  void getKingMoves(const Color color) const;
-  void getQueenMoves(const Color color) const;
-  void getBishopMoves(const Color color) const;
-  void getKnightMoves(const Color color) const;
-  void getRookMoves(const Color color) const;
-  void getPawnMoves(const Color color) const;
-  void getPawnDoublePushes(const Color color) const;
-  void getPawnAttacks(const Color color) const;
-  void getPawnEnPassants(const Color color) const;
-  void getCastlingMoves(const Color color) const;
-
-  void getMoves(BitBoard movers,
-                std::function<BitBoard(BitBoard)> targetGenerator,
-                Piece movingPiece, bool doublePushing = false,
-                bool enPassanting = false) const;
+  // What legal move generation needs to know about the mover's king.
+  struct KingSafety {
+    Square king;
+    BitBoard checkers;
+    BitBoard pinned;    // the mover's pieces that may only move along the pin
+    BitBoard evasions;  // capture or block the only checker; all if none
+  };
+
+  // What has been worked out about one position reached. applyMove()
+  // pushes an entry with nothing known and unapplyMove() pops it, so
+  // check detection, move generation and castling, whichever asks first,
+  // fill it in once for the rest to share. The entry also keeps what
+  // unapplyMove() cannot work out from the move alone.
+  struct Status {
+    KingSafety safety;  // the mover's
+    BitBoard unsafe;    // every square the side not to move attacks
+    int previousEP;     // _epAvailable before the move here, for unapplyMove()
+    bool safetyKnown;
+    bool unsafeKnown;
+  };
+
+  template <Color color>
+  BitBoard getAttackersOf(const Square square, const BitBoard occupied) const;
+  template <Color color>
+  KingSafety getKingSafety() const;
+  // getKingSafety() for the mover, through the status stack
+  template <Color color>
+  const KingSafety& getSafety() const;
+
+  template <Color color>
+  void getLegalMoves() const;
+  template <Color color, Piece piece>
+  BitBoard getTargetsFrom(const Square source) const;
+  template <Color color, Piece piece>
+  void getPieceMoves(const KingSafety& safety) const;
+  template <Color color>
+  void getKingMoves(const KingSafety& safety) const;
+  template <Color color>
+  void getKnightMoves(const KingSafety& safety) const;
+  template <Color color>
+  void getPawnMoves(const BitBoard pawns, const BitBoard allowed) const;
+  template <Color color>
+  void getEnPassants(const KingSafety& safety) const;
+  template <Color color>
+  void getCastlingMoves() const;
+
+  template <Color color, Piece piece, typename SourceOf>
+  void pushMoves(const BitBoard targets, const SourceOf sourceOf) const;
+  template <Color color, Piece piece>
+  void pushMove(const Square source, const Square target,
+                const Piece capturedPiece, const bool capturing) const;
+
+  // color is the side making the move, the one to move before applyMove()
+  template <Color color>
+  void applyMove(const Move move);
+  template <Color color>
+  void unapplyMove(const Move move);
+  template <Color color>
+  ZobristNumber getHashAfter(const Move move) const;
+  template <Color color>
+  ZobristNumber getPawnHashDelta(const Move move) const;
+
+  static const uint8_t EMPTY = 6;
 
   static bool parse(const char square, Color& color, Piece& piece);
 
+  void computeKeys();
+
   bool WKRookMoved() const { return _dirty & (1L << 0); }
   bool WQRookMoved() const { return _dirty & (1L << 7); }
   bool BKRookMoved() const { return _dirty & (1L << 56); }
@@ -88,11 +166,18 @@ class Board {
 
   std::array<BitBoard, 6> _pieces;
   std::array<BitBoard, 2> _colors;
+  // the piece on each square, kept in step with _pieces by applyMove() and
+  // unapplyMove() so nothing has to search six bitboards for it
+  std::array<uint8_t, 64> _mailbox;
   BNStack<Move, HEIGHTMAX> _moves;
   BNStack<int, HEIGHTMAX> _draw100Counter;
+  // one entry per position from the root, the current one on top
+  mutable BNStack<Status, HEIGHTMAX + 1> _status;
   BitBoard _dirty;
   Color _toMove;
   ZobristNumber _hash;
+  ZobristNumber _pawnHash;
+  MaterialKey _materialKey;
   int _epAvailable;
   TerminalState _terminalState;
 };
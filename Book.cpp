@@ -64,7 +64,7 @@ BixNix::Move Book::getMove() {
   if (_positions.end() == range.first) return result;
 
   // fitness proportional move selection
-  Book::Move winner;
+  Book::Move winner = 0;
   uint32_t totalWeight = 0;
   for (auto it = range.first; it != range.second; ++it) {
     totalWeight += std::get<1>(it->second);
@@ -87,7 +87,7 @@ BixNix::Move Book::getMove() {
 
   Square target = (7 - toFile) + (8 * toRank);
   Square source = (7 - fromFile) + (8 * fromRank);
-  Piece piece;
+  Piece piece = Queen;
   switch (promote) {
     case 0:
       piece = Queen;  // will be ignored, stop worrying
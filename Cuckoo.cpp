@@ -0,0 +1,81 @@
+#include <utility>
+
+#include "Bishops.h"
+#include "Cuckoo.h"
+#include "Kings.h"
+#include "Knights.h"
+#include "Rooks.h"
+#include "Zobrist.h"
+
+namespace BixNix {
+
+Cuckoo& Cuckoo::GetInstance() {
+  static Cuckoo instance;
+  return instance;
+}
+
+Cuckoo::Cuckoo() {
+  _keys.fill(0LL);
+  _moves.fill(0);
+
+
+  for (int color = White; color <= Black; ++color) {
+    for (const Piece piece : {Knight, Bishop, Rook, Queen, King}) {
+      for (Square source = 0; source < 64; ++source) {
+        BitBoard targets;
+        switch (piece) {
+          case Knight:
+            targets = Knights::getAttacksFrom(source);
+            break;
+          case Bishop:
+            targets = Bishops::getAttacksFrom(source, 0LL, 0LL);
+            break;
+          case Rook:
+            targets = Rooks::getAttacksFrom(source, 0LL, 0LL);
+            break;
+          case Queen:
+            targets = Bishops::getAttacksFrom(source, 0LL, 0LL) |
+                      Rooks::getAttacksFrom(source, 0LL, 0LL);
+            break;
+          default:
+            targets = Kings::getAttacksFrom(source);
+            break;
+        }
+        // each move once, in whichever direction it goes
+        targets &= ~((2LL << source) - 1);
+        while (0LL != targets) {
+          const Square target(popLowestSquare(targets));
+          insert(Zobrist::getZobrist(Color(color), piece, source) ^
+                     Zobrist::getZobrist(Color(color), piece, target) ^
+                     Zobrist::getBlackToMove(),
+                 source | (target << 6));
+        }
+      }
+    }
+  }
+}
+
+// Classic cuckoo insertion: take the slot, and move whatever was there to
+// its other slot, until something lands in an empty one.
+void Cuckoo::insert(ZobristNumber key, uint16_t move) {
+  size_t slot = getFirstSlot(key);
+  while (true) {
+    std::swap(_keys[slot], key);
+    std::swap(_moves[slot], move);
+    if (0 == move) break;
+    slot = (slot == getFirstSlot(key)) ? getSecondSlot(key) : getFirstSlot(key);
+  }
+}
+
+bool Cuckoo::getMove(const ZobristNumber delta, Square& source,
+                     Square& target) const {
+  size_t slot = getFirstSlot(delta);
+  if (_keys[slot] != delta) {
+    slot = getSecondSlot(delta);
+    if (_keys[slot] != delta) return false;
+  }
+  source = _moves[slot] & 0x3F;
+  target = _moves[slot] >> 6;
+  return true;
+}
+}
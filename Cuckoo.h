@@ -0,0 +1,41 @@
+#ifndef _CUCKOO_H_
+#define _CUCKOO_H_
+
+#include <array>
+
+#include "BitBoard.h"
+
+namespace BixNix {
+
+// Every reversible move of a knight, bishop, rook, queen or king, found by
+// the Zobrist delta it makes to the position key, side to move included.
+// If the key of the current position and one a few plies back differ by
+// such a delta, one move may bring that earlier position back.
+// https://www.chessprogramming.org/Cuckoo_Hashing
+class Cuckoo {
+ public:
+  static Cuckoo& GetInstance();
+  virtual ~Cuckoo() {}
+
+  bool getMove(const ZobristNumber delta, Square& source,
+               Square& target) const;
+
+ protected:
+  Cuckoo();
+
+  static const size_t SIZE = 8192;
+  static size_t getFirstSlot(const ZobristNumber key) {
+    return key & (SIZE - 1);
+  }
+  static size_t getSecondSlot(const ZobristNumber key) {
+    return (key >> 16) & (SIZE - 1);
+  }
+
+  void insert(ZobristNumber key, uint16_t move);
+
+  std::array<ZobristNumber, SIZE> _keys;
+  std::array<uint16_t, SIZE> _moves;  // source | target << 6, 0 if empty
+};
+}
+
+#endif  // _CUCKOO_H_
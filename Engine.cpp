@@ -4,6 +4,7 @@
 #include <climits>
 #include <ctime>
 #include <cmath>
+#include <cstring>
 #include <functional>
 #include <unordered_map>
 #include <vector>
@@ -32,20 +33,45 @@ void Engine::end() {
   LOG(trace) << _szL1 / static_cast<double>(_szL2) << " beta-cutoff ratio";
   LOG(trace) << _node_expansions / (900 - _time) << " expansions per second";
 
-  LOG(trace) << (_node_expansions + _ttable._hits) / (900 - _time)
+  const TranspositionTable::Stats& stats(_ttable.getStats());
+  const uint64_t hits(stats.getHits());
+  LOG(trace) << (_node_expansions + hits) / (900 - _time)
              << " expansions per second counting cache hits";
 
-  LOG(trace) << _ttable._hits << " cache hits";
-  LOG(trace) << _ttable._collisions << " cache collisions";
-  LOG(trace) << _ttable._misses << " cache misses";
-  LOG(trace) << _ttable._hits /
-                    static_cast<double>(_ttable._hits + _ttable._misses)
+  LOG(trace) << hits << " cache hits";
+  LOG(trace) << stats.getCutoffs() << " cache cutoffs";
+  LOG(trace) << stats.hits[int(MTDFTTNode::Type::Exact)] << " exact, "
+             << stats.hits[int(MTDFTTNode::Type::Lower)] << " lower, "
+             << stats.hits[int(MTDFTTNode::Type::Upper)] << " upper bound hits";
+  LOG(trace) << stats.getCollisions() << " cache collisions";
+  LOG(trace) << stats.misses << " cache misses";
+  LOG(trace) << stats.shallow << " cache hits too shallow to use";
+  LOG(trace) << hits / static_cast<double>(hits + stats.misses + stats.shallow)
              << " cache hit ratio";
 
-  size_t occupied(_ttable.getOccupancy());
-  size_t ttableSize(_ttable.getSize());
-
-  LOG(trace) << occupied / static_cast<double>(ttableSize) << " occupancy";
+  using Replacement = TranspositionTable::Replacement;
+  LOG(trace) << stats.replacements[int(Replacement::Empty)] << " empty, "
+             << stats.replacements[int(Replacement::Deeper)] << " deeper, "
+             << stats.replacements[int(Replacement::Stale)] << " stale, "
+             << stats.replacements[int(Replacement::Shallower)]
+             << " shallower, "
+             << stats.replacements[int(Replacement::Always)]
+             << " always-replace stores";
+  LOG(trace) << stats.refusals << " stores refused for a deeper result";
+#ifdef TTABLE_VERIFY
+  LOG(trace) << stats.falsePositives << " cache false positives";
+#endif
+
+  LOG(trace) << stats.hotHits << " hot cache hits";
+  LOG(trace) << stats.hotMisses << " hot cache misses";
+  LOG(trace) << stats.hotReplacements << " hot cache replacements";
+  LOG(trace) << stats.hotRejections << " hot cache rejections";
+
+  LOG(trace) << _ttable.getHashfull() << " hashfull";
+  const std::array<size_t, HEIGHTMAX> depths(_ttable.getDepthHistogram());
+  for (Depth depth = 0; depth < HEIGHTMAX; ++depth)
+    if (depths[depth])
+      LOG(trace) << depths[depth] << " sampled nodes at depth " << int(depth);
 
   LOG(trace) << _board._ms.maxHead() << " MoveStack Max";
 }
@@ -100,8 +126,9 @@ Move Engine::getMove() {
 }
 
 void Engine::search() {
-  while (!_search_end) {
+  while (true) {
     _searcherStarted.wait();
+    if (_search_end) return;
     innerSearch();
     _searcherStopped.wait();
   }
@@ -110,16 +137,17 @@ void Engine::search() {
 void Engine::innerSearch() {
   Color myColor = _board.getMover();
   unsigned int depth = 0;
+  bool stored = false;
   _board._ms.newFrame();
-  _board.getMoves(myColor);
-  _board._ms.popTo(std::remove_if(_board._ms.begin(), _board._ms.end(),
-                                  [&](Move& move) -> bool {
-    _board.applyMove(move);
-    bool bad = _board.inCheck(myColor);
-    _board.unapplyMove(move);
-    return bad;
-  }));
-  if (_board._ms.size() == 0) goto InnerSearchDone;
+  _board.getMoves(myColor, false);
+  // nothing from an earlier search may stand for this one
+  _best_move = Move(0);
+  _best_score = 0;
+  _best_depth = 0;
+  if (_board._ms.size() == 0) {
+    _best_score = _board.inCheck(myColor) ? -CHECKMATE : DRAW;
+    goto InnerSearchDone;
+  }
 
   _best_move = _board._ms[0];
   if (_board._ms.size() == 1) {
@@ -127,9 +155,11 @@ void Engine::innerSearch() {
     LOG(trace) << "only move: " << _best_move;
   }
   _best_move_ready.notify_all();
-  if (_board._ms.size() == 1) goto InnerSearchDone;
+  if (_best_move.getBestPossible()) goto InnerSearchDone;
 
   for (Move& m : _pv) m = 0;
+  stored = findStored();
+  if (stored) goto InnerSearchDone;
 
   while (!_search_stop) {
     emplaceFirstMove(_pv[0], Move(0));
@@ -138,19 +168,17 @@ void Engine::innerSearch() {
     Score score = std::numeric_limits<Score>::min();
     if (depth > (HEIGHTMAX - 32)) goto InnerSearchDone;
     LOG(trace) << "********* DEPTH " << depth;
-    LOG(trace) << "Threefold Table";
-    for (auto it : _3table._table) {
-      LOG(trace) << it.first << ": " << (int)it.second;
-    }
+    LOG(trace) << _3table.size() << " plies of repetition history";
     for (Move& m : _board._ms) {
       _board.applyMove(m);
       LOG(trace) << "hash: " << _board.getHash();
-      if (_3table.addWouldTrigger(_board.getHash())) {
+      if (_3table.addWouldTrigger(_board.getHash(),
+                                  _board.getReversiblePlies())) {
         score = DRAW;
       } else {
         _3table.add(_board.getHash());
         score = -negamax(depth);
-        _3table.remove(_board.getHash());
+        _3table.remove();
       }
 
       _board.unapplyMove(m);
@@ -173,6 +201,8 @@ void Engine::innerSearch() {
         if (CHECKMATE == bestScore) {
           _best_move = bestMoveThisDepth;
           _best_move.setBestPossible(true);
+          _best_score = bestScore;
+          _best_depth = depth + 1;
           _best_move_ready.notify_all();
           goto InnerSearchDone;
         }
@@ -180,14 +210,85 @@ void Engine::innerSearch() {
     }
 
     _best_move = bestMoveThisDepth;
+    _best_score = bestScore;
+    _best_depth = depth + 1;
     _best_move_ready.notify_all();
 
     ++depth;
+    if (_limits.depth && depth >= unsigned(_limits.depth)) goto InnerSearchDone;
   }
 InnerSearchDone:
+  if (!stored && _best_depth >= STORE_DEPTH) storeResult();
   _board._ms.popFrame();
 }
 
+// A stored move is always tried first; it only stands in for the search
+// if it was searched as deep as this one would go.
+bool Engine::findStored() {
+  AnalysisStore::Record record;
+  if (!_store.find(_board, record)) return false;
+
+  const Move move(record.pv[0]);
+  if (std::find(_board._ms.begin(), _board._ms.end(), move) == _board._ms.end())
+    return false;
+  _pv[0] = move;
+
+  if (record.depth < (_limits.depth ? _limits.depth : STORE_DEPTH))
+    return false;
+  _best_move = move;
+  _best_move.setBestPossible(true);
+  _best_score = record.score;
+  _best_depth = record.depth;
+  _best_move_ready.notify_all();
+  LOG(trace) << "stored d" << int(record.depth) << " (" << record.score
+             << "): " << move;
+  return true;
+}
+
+// The principal variation is followed through the transposition table for
+// as long as its moves are legal.
+void Engine::storeResult() {
+  if (!_store.isOpen()) return;
+  AnalysisStore::Record record;
+  if (_store.find(_board, record) && record.depth >= _best_depth) return;
+
+  std::memset(&record, 0, sizeof(record));
+  record.key = _board.getHash();
+  record.signature = _board.getSignature();
+  record.score = _best_score;
+  record.depth = _best_depth;
+
+  Move move(_best_move);
+  move.setBestPossible(false);
+  std::array<Move, AnalysisStore::PV_LENGTH> line;
+  int length = 0;
+  while (true) {
+    line[length] = move;
+    record.pv[length] = move;
+    _board.applyMove(move);
+    if (++length == AnalysisStore::PV_LENGTH) break;
+
+    Score alpha = -CHECKMATE, beta = CHECKMATE, score;
+    move = 0;
+    _ttable.get(_board.getHash(), 0, alpha, beta, score, move);
+    if (Move(0) == move) break;
+
+    // getMoves() would mark a mated line's end terminal
+    _board._ms.newFrame();
+    _board.getLegalMoves(_board.getMover());
+    const bool legal = std::find(_board._ms.begin(), _board._ms.end(),
+                                 move) != _board._ms.end();
+    _board._ms.popFrame();
+    if (!legal) break;
+  }
+  record.pvLength = length;
+  for (int i = length - 1; i >= 0; --i) _board.unapplyMove(line[i]);
+
+  const bool appended = _store.append(record);
+  LOG(trace) << (appended ? "stored" : "failed to store") << " d"
+             << int(record.depth) << " (" << record.score << "): " << line[0];
+}
+
 Score Engine::negamax(const Depth depth, Score alpha, Score beta,
                       const Depth height) {
   if (_search_stop) return 0;
@@ -201,11 +302,15 @@ Score Engine::negamax(const Depth depth, Score alpha, Score beta,
   uint8_t opens = 0;
   bool needToPop = false;
   bool firstMove = true;
+  bool evaluated = false;
+  bool repeats = false;
 
   if (_ttable.get(_board.getHash(), depth, alpha, beta, result, ttMove))
     return result;
 
   ++_node_expansions;
+  ++_search_nodes;
+  if (_limits.nodes && _search_nodes >= _limits.nodes) _search_stop = true;
 
   if (result >= beta) {
     _szL1 += opens;
@@ -213,25 +318,51 @@ Score Engine::negamax(const Depth depth, Score alpha, Score beta,
     goto NegamaxDone;
   }
 
-  if (0 == depth) {
-    result = Evaluate::GetInstance().getEvaluation(_board, myColor);
+  if (_board.isInsufficientMaterial()) {
+    result = DEAD_DRAW;
     goto NegamaxDone;
   }
 
-  if (_board.inCheckmate(myColor)) {
-    result = -CHECKMATE;
-    for (int i = height; i < _pv.size(); ++i) _pv[i] = 0;
-    goto NegamaxDone;
+  {
+    // a move from here repeats a position for the third time, so this
+    // node is worth at least what a repetition is worth to the mover.
+    // That depends on how the search got here, so a cutoff on it is not
+    // stored.
+    const Score drawScore = (height % 2 == 0) ? DRAW : CHECKMATE;
+    if (alpha < drawScore && _board.hasUpcomingRepetition(_3table)) {
+      if (drawScore >= beta) return drawScore;
+      alpha = drawScore;
+      result = drawScore;
+      repeats = true;
+    }
   }
 
-  if (_board.isDraw100()) {
-    result = DRAW;  // stalemate
+  if (0 == depth) {
+    result = std::max(result,
+                      Evaluate::GetInstance().getEvaluation(_board, myColor));
+    evaluated = true;
     goto NegamaxDone;
   }
 
   _board._ms.newFrame();
   needToPop = true;
-  _board.getMoves(myColor);
+  _board.getLegalMoves(myColor);
+
+  if (0 == _board._ms.size()) {
+    if (_board.inCheck(myColor)) {
+      result = -CHECKMATE;
+      for (int i = height; i < _pv.size(); ++i) _pv[i] = 0;
+    } else {
+      result = DRAW;
+    }
+    goto NegamaxDone;
+  }
+
+  // checkmate takes precedence over the fifty-move rule
+  if (_board.isDraw100()) {
+    result = DRAW;
+    goto NegamaxDone;
+  }
 
   emplaceFirstMove(pvMove, ttMove);
 
@@ -239,20 +370,22 @@ Score Engine::negamax(const Depth depth, Score alpha, Score beta,
     auto& m = *it;
     score = std::numeric_limits<Score>::min();
 
+    // the child probes the table first thing; overlap that miss with the
+    // rest of applyMove and the repetition check
+    _ttable.prefetch(_board.getHashAfter(m));
     _board.applyMove(m);
-    if (!_board.inCheck(myColor)) {
-      if (_3table.addWouldTrigger(_board.getHash())) {
-        // assume my opponent WANTS to tie
-        if (height % 2 == 0)
-          score = DRAW;
-        else
-          score = CHECKMATE;
-      } else {
-        _3table.add(_board.getHash());
-        score = -negamax(depth - 1, -beta, -alpha, height + 1);
-        ++opens;
-        _3table.remove(_board.getHash());
-      }
+    if (_3table.addWouldTrigger(_board.getHash(),
+                                _board.getReversiblePlies())) {
+      // assume my opponent WANTS to tie
+      if (height % 2 == 0)
+        score = DRAW;
+      else
+        score = CHECKMATE;
+    } else {
+      _3table.add(_board.getHash());
+      score = -negamax(depth - 1, -beta, -alpha, height + 1);
+      ++opens;
+      _3table.remove();
     }
     _board.unapplyMove(m);
     if (_search_stop) {
@@ -281,13 +414,21 @@ Score Engine::negamax(const Depth depth, Score alpha, Score beta,
     }
   }
 
-  if (0 == opens) {
-    result = DRAW;
-  }
-
 NegamaxDone:
   if (needToPop) _board._ms.popFrame();
-  _ttable.set(_board.getHash(), depth, alphaParent, beta, result, ttMove);
+  // an interrupted node's score is meaningless and would outlive this search.
+  if (_search_stop && !evaluated) return result;
+  // Raised to an upcoming repetition's score, leaf or not, a result only
+  // bounds what the position is worth from below. A static evaluation is
+  // otherwise exact whatever the window, so store it as such and any later
+  // visit takes it from the table without evaluating again.
+  if (repeats)
+    _ttable.set(_board.getHash(), depth, -CHECKMATE, result, result, ttMove);
+  else if (evaluated)
+    _ttable.set(_board.getHash(), depth, -CHECKMATE, CHECKMATE, result,
+                ttMove);
+  else
+    _ttable.set(_board.getHash(), depth, alphaParent, beta, result, ttMove);
   return result;
 }
 
@@ -312,27 +453,35 @@ void Engine::emplaceFirstMove(const Move& pvMove, const Move& ttMove) {
     std::swap(*begin, *bestIterator);
 }
 
-Engine::Engine()
+Engine::Engine(const size_t hashMegabytes)
     : _searcher(nullptr),
       _best_move(Move()),
+      _best_score(0),
+      _best_depth(0),
+      _search_nodes(0),
       _node_expansions(0),
       _szL1(0),
       _szL2(0),
       _search_stop(true),
       _search_end(false) {
-  _ttable.resize(TTSIZE);
+  setHashSize(hashMegabytes);
+  _ttable.resizeHot(HOT_HASH_KILOBYTES, HOT_HASH_DEPTH);
   _searcher = new std::thread(&Engine::search, this);
 }
 
+// Once stopped, the searcher is parked waiting for a search to start, so
+// it is started once more just to see _search_end and return.
 Engine::~Engine() {
-  _search_end = true;
   stopSearch();
+  _search_end = true;
+  _searcherStarted.wait();
   _searcher->join();
   _searcher = nullptr;
 }
 
 void Engine::startSearch() {
   if (true == _search_stop) {
+    _search_nodes = 0;
     _search_stop = false;
     _searcherStarted.wait();
   }
@@ -342,10 +491,85 @@ void Engine::stopSearch() {
   if (false == _search_stop) {
     _search_stop = true;
     _searcherStopped.wait();
-    _ttable.clear();
+    _ttable.newSearch();
   }
 }
 
+Engine::SearchResult Engine::searchPosition(const Board& board,
+                                            const SearchLimits& limits) {
+  stopSearch();
+
+  _board = board;
+  _3table.clear();
+  _3table.add(_board.getHash());
+
+  // the searcher thread stays parked in _searcherStarted while we run
+  // innerSearch() here, so nothing else touches the board or tables
+  _limits = limits;
+  if (0 == _limits.depth && 0 == _limits.nodes) _limits.depth = DEFAULT_DEPTH;
+  _search_nodes = 0;
+  _search_stop = false;
+  innerSearch();
+  _search_stop = true;
+  _limits = SearchLimits();
+
+  SearchResult result;
+  result.move = _best_move;
+  result.score = _best_score;
+  result.depth = _best_depth;
+  result.nodes = _search_nodes;
+
+  _ttable.newSearch();
+  return result;
+}
+
+void Engine::clearHash() { _ttable.clear(); }
+
+void Engine::setHashSize(const size_t megabytes) {
+  stopSearch();
+  _ttable.resize(megabytes);
+  LOG(trace) << "transposition table " << megabytes << " MB"
+             << (_ttable.getHugePages() ? " on huge pages" : "");
+}
+
+bool Engine::saveHash(const std::string& path) {
+  stopSearch();
+  const bool saved = _ttable.save(path);
+  LOG(trace) << (saved ? "saved" : "failed to save")
+             << " transposition table to " << path;
+  return saved;
+}
+
+bool Engine::loadHash(const std::string& path) {
+  stopSearch();
+  const bool loaded = _ttable.load(path);
+  LOG(trace) << (loaded ? "loaded" : "failed to load")
+             << " transposition table from " << path;
+  return loaded;
+}
+
+bool Engine::shareHash(const std::string& name, const size_t megabytes) {
+  stopSearch();
+  const bool shared = _ttable.share(name, megabytes);
+  LOG(trace) << (shared ? "sharing" : "failed to share")
+             << " transposition table " << name;
+  return shared;
+}
+
+bool Engine::openStore(const std::string& path) {
+  stopSearch();
+  const bool opened = _store.open(path);
+  LOG(trace) << (opened ? "opened" : "failed to open") << " analysis store "
+             << path << " with " << _store.getSorted() << " sorted and "
+             << _store.getAppended() << " appended results";
+  return opened;
+}
+
+void Engine::closeStore() {
+  stopSearch();
+  _store.close();
+}
+
 void Engine::init(Color color, float time) {
   srand(std::time(NULL));
   _color = color;
@@ -353,7 +577,9 @@ void Engine::init(Color color, float time) {
 
   _start_time = std::chrono::system_clock::now();
 
+  _ttable.clear();
   _board = Board::initial();
+  _3table.clear();
   _3table.add(_board.getHash());
 }
 
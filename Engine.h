@@ -11,10 +11,12 @@
 #include <climits>
 #include <condition_variable>
 #include <memory>
+#include <string>
 #include <thread>
 
 #include "Rendezvous.h"
 
+#include "AnalysisStore.h"
 #include "Enums.h"
 #include "Board.h"
 #include "TranspositionTable.h"
@@ -24,7 +26,31 @@ namespace BixNix {
 
 class Engine {
  public:
-  Engine();
+  // Deterministic stopping rules for searchPosition(). Zero means unlimited;
+  // the search stops at whichever limit is reached first. Iterative
+  // deepening adds exactly one ply per root iteration, so a depth limit is
+  // also an iteration limit. With neither set there is no timer to stop
+  // the search, so it goes DEFAULT_DEPTH plies deep.
+  struct SearchLimits {
+    SearchLimits() : depth(0), nodes(0) {}
+    Depth depth;     // plies searched by the last full iteration
+    uint64_t nodes;  // node expansions, may stop mid-iteration
+  };
+
+  struct SearchResult {
+    Move move;
+    Score score;
+    Depth depth;
+    uint64_t nodes;
+  };
+
+  static const size_t HASH_MEGABYTES = 1024;
+  static const size_t HOT_HASH_KILOBYTES = 256;
+  static const Depth HOT_HASH_DEPTH = 3;
+  static const Depth STORE_DEPTH = 6;
+  static const Depth DEFAULT_DEPTH = 6;
+
+  Engine(const size_t hashMegabytes = HASH_MEGABYTES);
   ~Engine();
 
   void init(Color color, float time);
@@ -33,11 +59,38 @@ class Engine {
   void reportMove(Move move, float time);
   Move getMove();
 
+  // Synchronous search of an arbitrary position on the calling thread, with
+  // no timer. The transposition table carries over between calls; after
+  // clearHash(), a given board and limits always expand the same nodes.
+  SearchResult searchPosition(const Board& board, const SearchLimits& limits);
+  void clearHash();
+  void setHashSize(const size_t megabytes);
+
+  // Warm-starts analysis from a table saved by an earlier session. init()
+  // still clears the table for a new game, so load after it.
+  bool saveHash(const std::string& path);
+  bool loadHash(const std::string& path);
+
+  // Shares the table with every other engine process that shares it under
+  // the same name; the first one sizes it. clearHash() and init() then
+  // leave it alone, since the others are still using it, but
+  // setHashSize() goes back to a table of this engine's own.
+  bool shareHash(const std::string& name,
+                 const size_t megabytes = HASH_MEGABYTES);
+
+  // With a store open, a position already searched deep enough is answered
+  // from it without searching, and searches reaching STORE_DEPTH are added
+  // to it. Deep enough is the depth limit, or STORE_DEPTH without one.
+  bool openStore(const std::string& path);
+  void closeStore();
+
  private:
   Score negamax(const Depth depth, Score alpha = -CHECKMATE,
                 Score beta = CHECKMATE, const Depth height = 1);
 
   void emplaceFirstMove(const Move& pvMove, const Move& ttMove);
+  bool findStored();
+  void storeResult();
 
   void startSearch();
   void stopSearch();
@@ -58,7 +111,11 @@ class Engine {
   Rendezvous _searcherStopped;
 
   Move _best_move;
+  Score _best_score;
+  Depth _best_depth;
 
+  SearchLimits _limits;
+  uint64_t _search_nodes;
   uint64_t _node_expansions;
 
   // https://chessprogramming.wikispaces.com/Sier%C5%BCant#Cutratio
@@ -67,9 +124,9 @@ class Engine {
 
   std::chrono::time_point<std::chrono::system_clock> _start_time;
 
-  static const int TTSIZE = 63000037;
   TranspositionTable _ttable;
   ThreefoldTable _3table;
+  AnalysisStore _store;
 
   std::array<Move, HEIGHTMAX> _pv;
 };
@@ -10,9 +10,11 @@ typedef uint64_t ZobristNumber;
 typedef uint8_t Square;
 typedef int16_t Score;
 typedef int8_t Depth;
+typedef uint64_t MaterialKey;
 
 const Score CHECKMATE = 15000;
 const Score DRAW = -14999;
+const Score DEAD_DRAW = 0;
 const Depth HEIGHTMAX = 64;
 
 enum Piece { Knight, Rook, Bishop, Queen, King, Pawn };
@@ -1,19 +1,40 @@
+#include <algorithm>
+
 #include "Logger.h"
 #include "Evaluate.h"
+#include "MaterialTable.h"
 
 namespace BixNix {
 
-Score Evaluate::getEvaluation(Board& board, const Color color) {
+// Leaf evaluation only; mate and stalemate are detected by the search
+// from its own move loop, so this never generates moves. Positions reached
+// by transposition are only scored once.
+Score Evaluate::getEvaluation(const Board& board, const Color color) {
   Score result = 0;
-  if (board.inCheckmate(board.getMover())) {
-    if (board.getMover() == color)
-      return -CHECKMATE;
-    else
-      return CHECKMATE;
+  if (!_evalTable.get(board.getHash(), result)) {
+    const MaterialTable::Entry material(
+        MaterialTable::GetInstance().getEntry(board.getMaterialKey()));
+    switch (material.evaluator) {
+      case MaterialTable::Evaluator::Draw:
+        result = DEAD_DRAW;
+        break;
+      case MaterialTable::Evaluator::KXK:
+        result = mopUpEval(board, material.strongSide, false);
+        break;
+      case MaterialTable::Evaluator::KBNK:
+        result = mopUpEval(board, material.strongSide, true);
+        break;
+      case MaterialTable::Evaluator::Normal:
+        int score = materialEval(board);
+        score += pieceSquareEval(board);
+        score += pawnStructureEval(board);
+        score = score * material.scale[score > 0 ? White : Black] /
+                MaterialTable::SCALE_NORMAL;
+        result = score;
+        break;
+    }
+    _evalTable.set(board.getHash(), result);
   }
-
-  result += materialEval(board);
-  result += pieceSquareEval(board);
   if (Black == color) result *= -1;
 
   return result;
@@ -55,22 +76,115 @@ Score Evaluate::pieceSquareEval(const Board& board) {
   for (size_t piece = 0; piece < 6; ++piece) {
     BitBoard dudes(board._pieces[piece] & board._colors[White]);
     while (0LL != dudes) {
-      const Square location(__builtin_ffsll(dudes) - 1);
-      dudes &= ~(1LL << location);
+      const Square location(popLowestSquare(dudes));
       result += _pieceSquare[White][piece][63 - location];
     }
 
     dudes = board._pieces[piece] & board._colors[Black];
     while (0LL != dudes) {
-      const Square location(__builtin_ffsll(dudes) - 1);
-      dudes &= ~(1LL << location);
+      const Square location(popLowestSquare(dudes));
       result -= _pieceSquare[Black][piece][63 - location];
     }
   }
   return result;
 }
 
-Evaluate::Evaluate() {
+// Only depends on where the pawns are, so it is looked up by the pawn key
+// first; most nodes share their pawn structure with many others.
+Score Evaluate::pawnStructureEval(const Board& board) {
+  Score result;
+  if (_pawnTable.get(board.getPawnHash(), result)) return result;
+
+  const BitBoard whitePawns(board._pieces[Pawn] & board._colors[White]);
+  const BitBoard blackPawns(board._pieces[Pawn] & board._colors[Black]);
+  result = pawnStructureEval(whitePawns, blackPawns, White) -
+           pawnStructureEval(blackPawns, whitePawns, Black);
+  _pawnTable.set(board.getPawnHash(), result);
+  return result;
+}
+
+// Against a lone king the piece-square tables only get in the way; what
+// wins is driving that king to the edge, or for bishop and knight to a
+// corner the bishop covers, with the stronger king close behind.
+Score Evaluate::mopUpEval(const Board& board, const Color strongSide,
+                          const bool bishopCorner) {
+  const Square strongKing(
+      getLowestSquare(board._pieces[King] & board._colors[strongSide]));
+  const Square weakKing(
+      getLowestSquare(board._pieces[King] & board._colors[1 - strongSide]));
+  const int file = weakKing & 7;
+  const int rank = weakKing >> 3;
+
+  int edge;
+  if (bishopCorner) {
+    // h1 is light and a1 dark; which corners matter depends on the bishop
+    const bool lightBishop(board._pieces[Bishop] & lightSquares);
+    const int toH =
+        lightBishop ? std::max(file, rank) : std::max(file, 7 - rank);
+    const int toA =
+        lightBishop ? std::max(7 - file, 7 - rank) : std::max(7 - file, rank);
+    edge = 7 - std::min(toH, toA);
+  } else {
+    edge = std::max(std::max(3 - file, file - 4), std::max(3 - rank, rank - 4));
+  }
+  const int kingDistance = std::max(std::abs(file - (strongKing & 7)),
+                                    std::abs(rank - (strongKing >> 3)));
+
+  int result = 50 + 20 * edge + 10 * (7 - kingDistance);
+  if (Black == strongSide) result = -result;
+  return materialEval(board) + result;
+}
+
+// Terms for one side's pawns, all found set-wise with fills along the
+// files. "Ahead" is north for White and south for Black.
+Score Evaluate::pawnStructureEval(const BitBoard pawns,
+                                  const BitBoard otherPawns,
+                                  const Color color) const {
+  const BitBoard all(~0ULL);
+  BitBoard aheadOfPawns, aheadOfOtherPawns, otherAttacks, stops;
+  if (White == color) {
+    aheadOfPawns = smearN(pawns, all);
+    aheadOfOtherPawns = shiftS(smearS(otherPawns, all));
+    otherAttacks = shiftSE(otherPawns) | shiftSW(otherPawns);
+    stops = shiftN(pawns);
+  } else {
+    aheadOfPawns = smearS(pawns, all);
+    aheadOfOtherPawns = shiftN(smearN(otherPawns, all));
+    otherAttacks = shiftNE(otherPawns) | shiftNW(otherPawns);
+    stops = shiftS(pawns);
+  }
+
+  const BitBoard files(smearN(pawns, all) | smearS(pawns, all));
+  const BitBoard neighbourFiles(shiftE(files) | shiftW(files));
+  // squares a friendly pawn could still come to defend
+  const BitBoard supportable(shiftE(aheadOfPawns) | shiftW(aheadOfPawns));
+  const BitBoard blocked(aheadOfOtherPawns | shiftE(aheadOfOtherPawns) |
+                         shiftW(aheadOfOtherPawns));
+
+  // a pawn with a friendly pawn ahead of it on its file
+  const BitBoard doubled(pawns & ((White == color)
+                                      ? shiftS(smearS(pawns, all))
+                                      : shiftN(smearN(pawns, all))));
+  const BitBoard isolated(pawns & ~neighbourFiles);
+  BitBoard backward(stops & otherAttacks & ~supportable);
+  backward = (White == color) ? shiftS(backward) : shiftN(backward);
+
+  int result = 0;
+  result += _doubled * __builtin_popcountll(doubled);
+  result += _isolated * __builtin_popcountll(isolated);
+  result += _backward * __builtin_popcountll(backward);
+
+  BitBoard passed(pawns & ~blocked & ~doubled);
+  while (0LL != passed) {
+    const Square location(popLowestSquare(passed));
+    const int rank = (White == color) ? location / 8 : 7 - location / 8;
+    result += _passedByRank[rank];
+  }
+  return result;
+}
+
+Evaluate::Evaluate()
+    : _pawnTable(PAWN_TABLE_ENTRIES), _evalTable(EVAL_TABLE_ENTRIES) {
   _material[Pawn] = 103;
   _material[Knight] = 325;  // 320
   _material[Bishop] = 337;  // 330
@@ -78,6 +192,11 @@ Evaluate::Evaluate() {
   _material[Queen] = 913;
   _material[King] = 20017;
 
+  _passedByRank = {0, 5, 10, 20, 35, 60, 100, 0};
+  _doubled = -12;
+  _isolated = -10;
+  _backward = -8;
+
   _pieceSquare[White][Pawn] = {
       0,  0,  0,  0,   0,   0,  0,  0,  50, 50, 50,  50, 50, 50,  50, 50,
       10, 10, 20, 30,  30,  20, 10, 10, 5,  5,  10,  25, 25, 10,  5,  5,
@@ -2,6 +2,7 @@
 #define _EVALUATE_H_
 
 #include "Board.h"
+#include "ScoreHashTable.h"
 
 namespace BixNix {
 
@@ -9,18 +10,35 @@ class Evaluate {
  public:
   static Evaluate& GetInstance();
   virtual ~Evaluate() {}
-  Score getEvaluation(Board& board, const Color color);
+  Score getEvaluation(const Board& board, const Color color);
   Score getEvaluation(const Move& move, const Color color);
 
  protected:
   Evaluate();
 
+  static const size_t PAWN_TABLE_ENTRIES = 1 << 14;
+  static const size_t EVAL_TABLE_ENTRIES = 1 << 16;
+
   // https://chessprogramming.wikispaces.com/Simplified+evaluation+function
   Score materialEval(const Board& board);
   Score pieceSquareEval(const Board& board);
+  Score mopUpEval(const Board& board, const Color strongSide,
+                  const bool bishopCorner);
+
+  // https://chessprogramming.wikispaces.com/Pawn+Structure
+  Score pawnStructureEval(const Board& board);
+  Score pawnStructureEval(const BitBoard pawns, const BitBoard otherPawns,
+                          const Color color) const;
 
   std::array<std::array<std::array<int, 64>, 6>, 2> _pieceSquare;
   std::array<int, 6> _material;
+  std::array<int, 8> _passedByRank;
+  int _doubled;
+  int _isolated;
+  int _backward;
+
+  ScoreHashTable _pawnTable;
+  ScoreHashTable _evalTable;
 };
 }
 
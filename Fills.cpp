@@ -0,0 +1,187 @@
+#include <immintrin.h>
+
+#include <cstdlib>
+
+#include "Fills.h"
+#include "Logger.h"
+
+namespace BixNix {
+
+namespace {
+
+// The SSE kernel pairs each upward direction with the downward one that
+// shifts by the same amount: low lane shifted left, high lane right. Like
+// the AVX2 kernel it names its own instruction set rather than relying on
+// the build flags, so isSupported() is what decides whether it runs.
+__attribute__((target("sse4.1"))) inline __m128i shiftApart(
+    const __m128i pair, const __m128i count) {
+  return _mm_blend_epi16(_mm_sll_epi64(pair, count),
+                         _mm_srl_epi64(pair, count), 0xF0);
+}
+
+// Attacks of both lanes' sliders through empty, masked to keep moves from
+// wrapping round the board's edge.
+__attribute__((target("sse4.1"))) inline __m128i fillApart(
+    __m128i slides, __m128i empty, const int shift, const __m128i mask) {
+  const __m128i once(_mm_cvtsi32_si128(shift));
+  const __m128i twice(_mm_cvtsi32_si128(2 * shift));
+  const __m128i fourTimes(_mm_cvtsi32_si128(4 * shift));
+  empty = _mm_and_si128(empty, mask);
+  slides = _mm_or_si128(slides,
+                        _mm_and_si128(empty, shiftApart(slides, once)));
+  empty = _mm_and_si128(empty, shiftApart(empty, once));
+  slides = _mm_or_si128(slides,
+                        _mm_and_si128(empty, shiftApart(slides, twice)));
+  empty = _mm_and_si128(empty, shiftApart(empty, twice));
+  slides = _mm_or_si128(slides,
+                        _mm_and_si128(empty, shiftApart(slides, fourTimes)));
+  return _mm_and_si128(shiftApart(slides, once), mask);
+}
+}
+
+Fills::Kernel Fills::_kernel = Fills::Scalar;
+
+BitBoard (*Fills::_fill)(BitBoard, BitBoard,
+                         BitBoard) = &Fills::getScalarAttacks;
+
+// made before main() runs, so the choice is in place before any search
+const bool Fills::_chosen(Fills::setKernel(Fills::choose()));
+
+Fills::Kernel Fills::choose() {
+  Kernel kernel(isSupported(AVX2) ? AVX2 : Scalar);
+  const char* name(getenv("BIXNIX_FILLS"));
+  if (nullptr != name) {
+    Kernel requested;
+    if (parse(name, requested) && isSupported(requested))
+      kernel = requested;
+    else
+      LOG(trace) << "BIXNIX_FILLS=" << name << " is not available here";
+  }
+  LOG(trace) << "attack fills by " << getName(kernel);
+  return kernel;
+}
+
+bool Fills::isSupported(const Kernel kernel) {
+  switch (kernel) {
+    case Scalar:
+      return true;
+    case SSE:
+      return __builtin_cpu_supports("sse4.1");
+    case AVX2:
+      return __builtin_cpu_supports("avx2");
+    default:
+      return false;
+  }
+}
+
+const char* Fills::getName(const Kernel kernel) {
+  switch (kernel) {
+    case Scalar:
+      return "scalar";
+    case SSE:
+      return "sse";
+    case AVX2:
+      return "avx2";
+    default:
+      return "unknown";
+  }
+}
+
+bool Fills::parse(const std::string& name, Kernel& kernel) {
+  for (int candidate = 0; candidate < KERNELS; ++candidate) {
+    if (name == getName(Kernel(candidate))) {
+      kernel = Kernel(candidate);
+      return true;
+    }
+  }
+  return false;
+}
+
+bool Fills::setKernel(const Kernel kernel) {
+  if (!isSupported(kernel)) return false;
+  _kernel = kernel;
+  switch (kernel) {
+    case SSE:
+      _fill = &Fills::getSSEAttacks;
+      break;
+    case AVX2:
+      _fill = &Fills::getAVX2Attacks;
+      break;
+    default:
+      _fill = &Fills::getScalarAttacks;
+      break;
+  }
+  return true;
+}
+
+BitBoard Fills::getScalarAttacks(BitBoard rooks, BitBoard bishops,
+                                 BitBoard occupied) {
+  const BitBoard empty(~occupied);
+  return shiftN(smearN(rooks, empty)) | shiftS(smearS(rooks, empty)) |
+         shiftE(smearE(rooks, empty)) | shiftW(smearW(rooks, empty)) |
+         shiftNE(smearNE(bishops, empty)) | shiftSE(smearSE(bishops, empty)) |
+         shiftSW(smearSW(bishops, empty)) | shiftNW(smearNW(bishops, empty));
+}
+
+// Pairs N with S, W with E, NE with SW and NW with SE.
+__attribute__((target("sse4.1"))) BitBoard Fills::getSSEAttacks(
+    BitBoard rooks, BitBoard bishops, BitBoard occupied) {
+  const __m128i empty(_mm_set1_epi64x(~occupied));
+  const __m128i rookPair(_mm_set1_epi64x(rooks));
+  const __m128i bishopPair(_mm_set1_epi64x(bishops));
+  const __m128i attacks(_mm_or_si128(
+      _mm_or_si128(fillApart(rookPair, empty, 8, _mm_set1_epi64x(~0LL)),
+                   fillApart(rookPair, empty, 1,
+                             _mm_set_epi64x(notAFile, notHFile))),
+      _mm_or_si128(fillApart(bishopPair, empty, 7,
+                             _mm_set_epi64x(notHFile, notAFile)),
+                   fillApart(bishopPair, empty, 9,
+                             _mm_set_epi64x(notAFile, notHFile)))));
+  return _mm_cvtsi128_si64(attacks) | _mm_extract_epi64(attacks, 1);
+}
+
+// Lanes, low to high, go N, W, NE, NW in one register and S, E, SW, SE in
+// the other; each lane shifts by its own amount.
+__attribute__((target("avx2"))) BitBoard Fills::getAVX2Attacks(
+    BitBoard rooks, BitBoard bishops, BitBoard occupied) {
+  const __m256i once(_mm256_set_epi64x(9, 7, 1, 8));
+  const __m256i twice(_mm256_add_epi64(once, once));
+  const __m256i fourTimes(_mm256_add_epi64(twice, twice));
+  const __m256i upMask(_mm256_set_epi64x(notHFile, notAFile, notHFile, ~0LL));
+  const __m256i downMask(
+      _mm256_set_epi64x(notAFile, notHFile, notAFile, ~0LL));
+  const __m256i empty(_mm256_set1_epi64x(~occupied));
+
+  __m256i up(_mm256_set_epi64x(bishops, bishops, rooks, rooks));
+  __m256i down(up);
+  __m256i upEmpty(_mm256_and_si256(empty, upMask));
+  __m256i downEmpty(_mm256_and_si256(empty, downMask));
+
+  up = _mm256_or_si256(up,
+                       _mm256_and_si256(upEmpty, _mm256_sllv_epi64(up, once)));
+  down = _mm256_or_si256(
+      down, _mm256_and_si256(downEmpty, _mm256_srlv_epi64(down, once)));
+  upEmpty = _mm256_and_si256(upEmpty, _mm256_sllv_epi64(upEmpty, once));
+  downEmpty = _mm256_and_si256(downEmpty, _mm256_srlv_epi64(downEmpty, once));
+
+  up = _mm256_or_si256(
+      up, _mm256_and_si256(upEmpty, _mm256_sllv_epi64(up, twice)));
+  down = _mm256_or_si256(
+      down, _mm256_and_si256(downEmpty, _mm256_srlv_epi64(down, twice)));
+  upEmpty = _mm256_and_si256(upEmpty, _mm256_sllv_epi64(upEmpty, twice));
+  downEmpty = _mm256_and_si256(downEmpty, _mm256_srlv_epi64(downEmpty, twice));
+
+  up = _mm256_or_si256(
+      up, _mm256_and_si256(upEmpty, _mm256_sllv_epi64(up, fourTimes)));
+  down = _mm256_or_si256(
+      down, _mm256_and_si256(downEmpty, _mm256_srlv_epi64(down, fourTimes)));
+
+  const __m256i attacks(
+      _mm256_or_si256(_mm256_and_si256(_mm256_sllv_epi64(up, once), upMask),
+                      _mm256_and_si256(_mm256_srlv_epi64(down, once),
+                                       downMask)));
+  const __m128i halves(_mm_or_si128(_mm256_castsi256_si128(attacks),
+                                    _mm256_extracti128_si256(attacks, 1)));
+  return _mm_cvtsi128_si64(halves) | _mm_extract_epi64(halves, 1);
+}
+}
@@ -0,0 +1,57 @@
+#ifndef _FILLS_H_
+#define _FILLS_H_
+
+#include <string>
+
+#include "BitBoard.h"
+
+namespace BixNix {
+
+// Every square a set of rooks and a set of bishops attack, for a whole
+// side at once rather than a slider at a time. That is eight Kogge-Stone
+// fills, one per direction, which do not depend on each other and so run
+// side by side in vector lanes where the CPU has them. The kernel is
+// chosen at startup from what the CPU reports, unless the BIXNIX_FILLS
+// environment variable names one.
+class Fills {
+ public:
+  enum Kernel {
+    Scalar,  // the smears from BitBoard.h, one direction after another
+    SSE,     // two opposite directions per 128-bit register
+    AVX2,    // the four up and the four down directions per register
+    KERNELS
+  };
+
+  // occupied blocks the fills and should include the sliders themselves
+  static BitBoard getAttacks(BitBoard rooks, BitBoard bishops,
+                             BitBoard occupied) {
+    return _fill(rooks, bishops, occupied);
+  }
+
+  static bool isSupported(const Kernel kernel);
+  static const char* getName(const Kernel kernel);
+  static bool parse(const std::string& name, Kernel& kernel);
+
+  static Kernel getKernel() { return _kernel; }
+  // false, changing nothing, if the CPU cannot run it
+  static bool setKernel(const Kernel kernel);
+
+ protected:
+  static Kernel choose();
+
+  static BitBoard getScalarAttacks(BitBoard rooks, BitBoard bishops,
+                                   BitBoard occupied);
+  static BitBoard getSSEAttacks(BitBoard rooks, BitBoard bishops,
+                                BitBoard occupied);
+  static BitBoard getAVX2Attacks(BitBoard rooks, BitBoard bishops,
+                                 BitBoard occupied);
+
+  static Kernel _kernel;
+  // the scalar fills until the choice is made at startup
+  static BitBoard (*_fill)(BitBoard rooks, BitBoard bishops,
+                           BitBoard occupied);
+  static const bool _chosen;
+};
+}
+
+#endif  // _FILLS_H_
@@ -1,22 +1,39 @@
 #ifndef _KINGS_H_
 #define _KINGS_H_
 
+#include <array>
+
 #include "BitBoard.h"
-#include "Board.h"
 
 namespace BixNix {
 
 class Kings {
  public:
-  static Kings& GetInstance();
-  virtual ~Kings();
-  BitBoard getAttacksFrom(Square kingSquare);
-  BitBoard getAttacksFrom(BitBoard king, BitBoard obstructions);
+  static BitBoard getAttacksFrom(Square kingSquare) {
+    return ATTACKS[kingSquare];
+  }
+  static BitBoard getAttacksFrom(BitBoard king, BitBoard obstructions);
 
  protected:
-  Kings();
-  BitBoard generateOneStepsFrom(Square index);
-  std::array<BitBoard, 64> _attacks;
+  static constexpr BitBoard generateOneStepsFrom(Square index) {
+    const BitBoard king = 1LL << index;
+    const BitBoard westEdge = king & notAFile;
+    const BitBoard eastEdge = king & notHFile;
+
+    return (king << 8) | (king >> 8) | (westEdge << 9) | (westEdge << 1) |
+           (westEdge >> 7) | (eastEdge << 7) | (eastEdge >> 1) |
+           (eastEdge >> 9);
+  }
+
+  static constexpr std::array<BitBoard, 64> generateAttacks() {
+    std::array<BitBoard, 64> attacks{};
+    for (Square index = 0; index < 64; ++index)
+      attacks[index] = generateOneStepsFrom(index);
+    return attacks;
+  }
+
+  // defined constexpr in Kings.cpp, so it is filled in at compile time
+  static const std::array<BitBoard, 64> ATTACKS;
 };
 }
 
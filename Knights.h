@@ -2,21 +2,35 @@
 #define _KNIGHTS_H_
 
 #include <array>
-#include "Board.h"
+
+#include "BitBoard.h"
 
 namespace BixNix {
 
 class Knights {
  public:
-  static Knights& GetInstance();
-  virtual ~Knights();
-  BitBoard getAttacksFrom(Square index);
-  BitBoard getAttacksFrom(BitBoard knights, BitBoard obstructions);
+  static BitBoard getAttacksFrom(Square index) { return ATTACKS[index]; }
+  static BitBoard getAttacksFrom(BitBoard knights, BitBoard obstructions);
 
  protected:
-  Knights();
-  BitBoard generateAttacksFrom(Square index);
-  std::array<BitBoard, 64> _attacks;
+  static constexpr BitBoard generateAttacksFrom(Square index) {
+    const BitBoard x = 1LL << index;
+
+    return (x & notAFile) << 17 | (x & notAFile) >> 15 |
+           (x & notABFile) >> 6 | (x & notABFile) << 10 |
+           (x & notHFile) << 15 | (x & notHFile) >> 17 |
+           (x & notGHFile) << 6 | (x & notGHFile) >> 10;
+  }
+
+  static constexpr std::array<BitBoard, 64> generateAttacks() {
+    std::array<BitBoard, 64> attacks{};
+    for (Square index = 0; index < 64; ++index)
+      attacks[index] = generateAttacksFrom(index);
+    return attacks;
+  }
+
+  // defined constexpr in Knights.cpp, so it is filled in at compile time
+  static const std::array<BitBoard, 64> ATTACKS;
 };
 }
 
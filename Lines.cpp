@@ -0,0 +1,37 @@
+#include "Lines.h"
+
+namespace BixNix {
+
+// Two squares are aligned when they share a file, a rank or a diagonal.
+// The steps from one to the other then give the squares between, and
+// walking those steps both ways out from either gives the line.
+constexpr Lines::Tables Lines::generateTables() {
+  Tables tables{};
+  for (int a = 0; a < 64; ++a) {
+    for (int b = 0; b < 64; ++b) {
+      const int files((b & 7) - (a & 7));
+      const int ranks((b >> 3) - (a >> 3));
+      if (a == b || (files && ranks && files != ranks && files != -ranks))
+        continue;
+
+      const int fileStep((files > 0) - (files < 0));
+      const int rankStep((ranks > 0) - (ranks < 0));
+      const int step(rankStep * 8 + fileStep);
+      for (int square = a + step; square != b; square += step)
+        tables.between[a][b] |= 1LL << square;
+
+      for (const int direction : {1, -1}) {
+        int file(a & 7), rank(a >> 3);
+        while (file >= 0 && file < 8 && rank >= 0 && rank < 8) {
+          tables.line[a][b] |= 1LL << (rank * 8 + file);
+          file += direction * fileStep;
+          rank += direction * rankStep;
+        }
+      }
+    }
+  }
+  return tables;
+}
+
+constexpr Lines::Tables Lines::TABLES = Lines::generateTables();
+}
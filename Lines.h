@@ -0,0 +1,35 @@
+#ifndef _LINES_H_
+#define _LINES_H_
+
+#include <array>
+
+#include "BitBoard.h"
+
+namespace BixNix {
+
+// Squares in line with two others, for pins, checks and blocking. Both are
+// empty unless the squares share a rank, file or diagonal.
+class Lines {
+ public:
+  // squares strictly between the two
+  static BitBoard getBetween(const Square a, const Square b) {
+    return TABLES.between[a][b];
+  }
+  // the whole line through both, edge to edge
+  static BitBoard getLine(const Square a, const Square b) {
+    return TABLES.line[a][b];
+  }
+
+ protected:
+  struct Tables {
+    std::array<std::array<BitBoard, 64>, 64> between;
+    std::array<std::array<BitBoard, 64>, 64> line;
+  };
+
+  static constexpr Tables generateTables();
+  // defined constexpr in Lines.cpp, so it is filled in at compile time
+  static const Tables TABLES;
+};
+}
+
+#endif  // _LINES_H_
@@ -8,17 +8,23 @@
 
 namespace BixNix {
 
+// Packed into 8 bytes; the key fragment that identifies a node lives beside
+// it in its TranspositionTable bucket. All-zero is an empty node.
 class MTDFTTNode {
  public:
-  enum class Type : uint8_t { Exact, Lower, Upper };
-  MTDFTTNode() : _hash(0xFFFFFFFFFFFFFFFFLL), _score(0), _depth(0), _move(0) {}
+  enum class Type : uint8_t { Empty, Exact, Lower, Upper };
+  MTDFTTNode() = default;
 
-  ZobristNumber _hash;
+  bool empty() const { return _type == uint8_t(Type::Empty); }
+
+  Move::Data _move;
   Score _score;
-  Type _type;
   Depth _depth;
-  Move::Data _move;
+  uint8_t _type : 2;        // a Type
+  uint8_t _generation : 6;  // search that last stored or probed this node
 };
+
+static_assert(sizeof(MTDFTTNode) == 8, "MTDFTTNode should pack to 8 bytes");
 }
 
 #endif  // _TRANSPOSITION_NODE_H_
@@ -0,0 +1,128 @@
+#include "MaterialTable.h"
+
+namespace BixNix {
+
+namespace {
+
+const int KNIGHT = 325;
+const int BISHOP = 337;
+const int ROOK = 511;
+const int QUEEN = 913;
+
+int getNonPawnMaterial(const MaterialKey key, const Color color) {
+  return KNIGHT * MaterialTable::getCount(key, color, Knight) +
+         BISHOP * MaterialTable::getCount(key, color, Bishop) +
+         ROOK * MaterialTable::getCount(key, color, Rook) +
+         QUEEN * MaterialTable::getCount(key, color, Queen);
+}
+
+// Nothing but the king and at most one minor piece.
+bool hasAtMostAMinor(const MaterialKey key, const Color color) {
+  if (MaterialTable::getCount(key, color, Pawn) ||
+      MaterialTable::getCount(key, color, Rook) ||
+      MaterialTable::getCount(key, color, Queen))
+    return false;
+  return MaterialTable::getCount(key, color, Knight) +
+             MaterialTable::getCount(key, color, Bishop) <=
+         1;
+}
+}
+
+MaterialTable& MaterialTable::GetInstance() {
+  static MaterialTable instance;
+  return instance;
+}
+
+// Walks every signature the table covers and fills in its entry.
+MaterialTable::MaterialTable()
+    : _table(PIECE_SIGNATURES * PIECE_SIGNATURES * 4) {
+  const int limits[] = {3, 3, 3, 2};
+  const Piece pieces[] = {Knight, Bishop, Rook, Queen};
+  for (int white = 0; white < PIECE_SIGNATURES; ++white) {
+    for (int black = 0; black < PIECE_SIGNATURES; ++black) {
+      for (int pawns = 0; pawns < 4; ++pawns) {
+        MaterialKey key = getDelta(White, King) + getDelta(Black, King);
+        int whiteDigits = white;
+        int blackDigits = black;
+        for (int i = 0; i < 4; ++i) {
+          key += (whiteDigits % limits[i]) * getDelta(White, pieces[i]);
+          key += (blackDigits % limits[i]) * getDelta(Black, pieces[i]);
+          whiteDigits /= limits[i];
+          blackDigits /= limits[i];
+        }
+        if (pawns & 1) key += getDelta(White, Pawn);
+        if (pawns & 2) key += getDelta(Black, Pawn);
+        _table[(white * PIECE_SIGNATURES + black) * 4 + pawns] = compute(key);
+      }
+    }
+  }
+}
+
+int MaterialTable::getSignature(const MaterialKey key, const Color color) {
+  const int knights = getCount(key, color, Knight);
+  const int bishops = getCount(key, color, Bishop);
+  const int rooks = getCount(key, color, Rook);
+  const int queens = getCount(key, color, Queen);
+  if (knights > 2 || bishops > 2 || rooks > 2 || queens > 1) return -1;
+  return knights + 3 * (bishops + 3 * (rooks + 3 * queens));
+}
+
+MaterialTable::Entry MaterialTable::getEntry(const MaterialKey key) const {
+  const int white = getSignature(key, White);
+  const int black = getSignature(key, Black);
+  if (white < 0 || black < 0) return compute(key);
+
+  const int pawns = (getCount(key, White, Pawn) ? 1 : 0) |
+                    (getCount(key, Black, Pawn) ? 2 : 0);
+  return _table[(white * PIECE_SIGNATURES + black) * 4 + pawns];
+}
+
+// Only the number of pawns (none or some) and pieces matters here, so a
+// key with its pawn counts capped at one gives the same entry.
+MaterialTable::Entry MaterialTable::compute(const MaterialKey key) {
+  Entry entry;
+  entry.evaluator = Evaluator::Normal;
+  entry.strongSide = White;
+  entry.scale = {SCALE_NORMAL, SCALE_NORMAL};
+
+  // KvK, KNvK and KBvK. A minor piece each can still be mated in a
+  // corner, so that is only scaled down below.
+  if (hasAtMostAMinor(key, White) && hasAtMostAMinor(key, Black) &&
+      getNonPawnMaterial(key, White) + getNonPawnMaterial(key, Black) <=
+          BISHOP) {
+    entry.evaluator = Evaluator::Draw;
+    entry.scale = {0, 0};
+    return entry;
+  }
+
+  for (int side = White; side <= Black; ++side) {
+    const Color color = Color(side);
+    const Color other = Color(1 - side);
+    const int material = getNonPawnMaterial(key, color);
+    const int otherMaterial = getNonPawnMaterial(key, other);
+
+    // a pawnless side that is at most a minor piece up can rarely win
+    if (0 == getCount(key, color, Pawn) && material - otherMaterial <= BISHOP)
+      entry.scale[color] =
+          material < ROOK ? 0 : (otherMaterial <= BISHOP ? 4 : 14);
+
+    // two knights cannot force mate on a lone king
+    if (0 == getCount(key, color, Pawn) && material == 2 * KNIGHT &&
+        0 == otherMaterial)
+      entry.scale[color] = 4;
+
+    // the other king is alone
+    if (0 == otherMaterial && 0 == getCount(key, other, Pawn)) {
+      entry.strongSide = color;
+      if (0 == getCount(key, color, Pawn)) {
+        if (getCount(key, color, Rook) || getCount(key, color, Queen))
+          entry.evaluator = Evaluator::KXK;
+        else if (1 == getCount(key, color, Bishop) &&
+                 1 == getCount(key, color, Knight))
+          entry.evaluator = Evaluator::KBNK;
+      }
+    }
+  }
+  return entry;
+}
+}
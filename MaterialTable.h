@@ -0,0 +1,60 @@
+#ifndef _MATERIALTABLE_H_
+#define _MATERIALTABLE_H_
+
+#include <array>
+#include <vector>
+
+#include "Enums.h"
+
+namespace BixNix {
+
+// What the pieces on the board say about a position before looking at
+// where they stand. Board keeps a MaterialKey, a count of each color's
+// pieces four bits apiece, which getEntry() turns into a table index.
+class MaterialTable {
+ public:
+  enum class Evaluator : uint8_t {
+    Normal,
+    Draw,  // neither side can ever mate: KvK, KNvK and KBvK
+    KXK,   // lone king against a rook or queen: herd it to the edge
+    KBNK   // lone king against bishop and knight: herd it to a corner
+  };
+
+  // Scores in a side's favour are multiplied by scale[side] / SCALE_NORMAL.
+  struct Entry {
+    Evaluator evaluator;
+    Color strongSide;
+    std::array<uint8_t, 2> scale;
+  };
+
+  static const uint8_t SCALE_NORMAL = 64;
+
+  static MaterialTable& GetInstance();
+  virtual ~MaterialTable() {}
+
+  static MaterialKey getDelta(const Color color, const Piece piece) {
+    return MaterialKey(1) << (4 * (6 * color + piece));
+  }
+  static int getCount(const MaterialKey key, const Color color,
+                      const Piece piece) {
+    return (key >> (4 * (6 * color + piece))) & 0xF;
+  }
+
+  Entry getEntry(const MaterialKey key) const;
+
+ protected:
+  MaterialTable();
+
+  // The table covers up to two knights, bishops and rooks and a queen per
+  // side, with pawns only told apart as none or some; anything beyond that
+  // takes a promotion and is worked out on the spot.
+  static const int PIECE_SIGNATURES = 3 * 3 * 3 * 2;
+  static int getSignature(const MaterialKey key, const Color color);
+
+  static Entry compute(const MaterialKey key);
+
+  std::vector<Entry> _table;
+};
+}
+
+#endif  // _MATERIALTABLE_H_
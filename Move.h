@@ -11,41 +11,104 @@ namespace BixNix {
 class Move {
  public:
   typedef uint32_t Data;
-  Move() : _data(0x0000) {}
-  Move(uint32_t data) : _data(data) {}
-  Move(Square source, Square target, Piece piece);
-  Move(Square source, Square target, Piece movingPiece, Piece capturedPiece,
-       Piece promotionPiece, bool promoting, bool capturing, bool doublePushing,
-       bool enPassanting, int enPassantTargetFile, bool castling,
-       bool castlingDirection, bool sourceDirtied, bool targetDirtied);
-
-  operator uint32_t() const { return _data; }
+  constexpr Move() : score(0), _data(0x0000) {}
+  constexpr Move(uint32_t data) : score(0), _data(data) {}
+  // Just the squares and a promotion piece, for moves from outside the
+  // engine; applyExternalMove() works out the rest.
+  constexpr Move(Square source, Square target, Piece piece)
+      : score(0),
+        _data((SOURCE_MASK & uint32_t(source)) |
+              (TARGET_MASK & (uint32_t(target) << 6)) |
+              (PROMO_TYPE_MASK & (uint32_t(piece) << 12)) | PROMO_FLAG_MASK) {}
+
+  // A piece going from source to target and taking nothing, encoded the
+  // way generated moves always have been: the unused captured and
+  // promotion pieces are Pawn and every en passant file bit is set. With
+  // the piece known at compile time all but the squares is one constant.
+  // The with...() calls below add the rest.
+  static constexpr Move base(Piece piece, Square source, Square target) {
+    return Move(UNUSED_FIELDS | (uint32_t(piece) << 16) | uint32_t(source) |
+                (uint32_t(target) << 6));
+  }
+
+  constexpr Move withCapture(Piece capturedPiece) const {
+    return Move((_data & ~TARGET_TYPE_MASK) | CAPTURE_FLAG_MASK |
+                (uint32_t(capturedPiece) << 19));
+  }
+  constexpr Move withPromotion(Piece promotionPiece) const {
+    return Move((_data & ~PROMO_TYPE_MASK) | PROMO_FLAG_MASK |
+                (PROMO_TYPE_MASK & (uint32_t(promotionPiece) << 12)));
+  }
+  constexpr Move withDoublePush() const {
+    return Move((_data & ~EP_FILE_MASK) | DPUSH_FLAG_MASK |
+                ((_data & 7) << 24));
+  }
+  constexpr Move withEnPassant() const {
+    return Move(_data | CAPTURE_FLAG_MASK | EP_CAP_FLAG_MASK);
+  }
+  constexpr Move withCastling(bool kingSide) const {
+    return Move(_data | CASTL_FLAG_MASK | DIRTY_SOURCE_MASK |
+                (kingSide ? CASTL_DIR_MASK : 0));
+  }
+  // Whether this move is the first to touch each square, given the
+  // squares already dirtied.
+  constexpr Move withDirtied(BitBoard dirty) const {
+    return Move(_data | (uint32_t((~dirty >> getSource()) & 1) << 29) |
+                (uint32_t((~dirty >> getTarget()) & 1) << 30));
+  }
+
+  constexpr operator uint32_t() const { return _data; }
 
   std::string debug();
 
-  Square getSource() const;
-  Square getTarget() const;
-
-  Piece getMovingPiece() const;
-  Piece getCapturedPiece() const;
-  Piece getPromotionPiece() const;
-
-  bool getPromoting() const;
-  bool getCapturing() const;
-  bool getDoublePushing() const;
-  bool getEnPassanting() const;
-  int getEnPassantTargetFile() const;
-
-  bool getCastling() const;
-  bool getCastlingDirection() const;
-
-  bool getSourceDirtied() const;
-  bool getTargetDirtied() const;
-
-  bool getBestPossible() const;
-  void setBestPossible(const bool flag);
-
-  bool operator==(const Move& rhs) const;
+  constexpr Square getSource() const { return Square(_data & SOURCE_MASK); }
+  constexpr Square getTarget() const {
+    return Square((_data & TARGET_MASK) >> 6);
+  }
+
+  constexpr Piece getMovingPiece() const {
+    return Piece((_data & PIECE_TYPE_MASK) >> 16);
+  }
+  constexpr Piece getCapturedPiece() const {
+    return Piece((_data & TARGET_TYPE_MASK) >> 19);
+  }
+  constexpr Piece getPromotionPiece() const {
+    return Piece((_data & PROMO_TYPE_MASK) >> 12);
+  }
+
+  constexpr bool getPromoting() const { return _data & PROMO_FLAG_MASK; }
+  constexpr bool getCapturing() const { return _data & CAPTURE_FLAG_MASK; }
+  constexpr bool getDoublePushing() const { return _data & DPUSH_FLAG_MASK; }
+  constexpr bool getEnPassanting() const { return _data & EP_CAP_FLAG_MASK; }
+  constexpr int getEnPassantTargetFile() const {
+    return (_data & EP_FILE_MASK) >> 24;
+  }
+
+  constexpr bool getCastling() const { return _data & CASTL_FLAG_MASK; }
+  constexpr bool getCastlingDirection() const {
+    return _data & CASTL_DIR_MASK;
+  }
+
+  constexpr bool getSourceDirtied() const {
+    return _data & DIRTY_SOURCE_MASK;
+  }
+  constexpr bool getTargetDirtied() const {
+    return _data & DIRTY_TARGET_MASK;
+  }
+
+  constexpr bool getBestPossible() const {
+    return _data & BEST_POSSIBLE_MASK;
+  }
+  void setBestPossible(const bool flag) {
+    if (flag)
+      _data |= BEST_POSSIBLE_MASK;
+    else
+      _data &= ~BEST_POSSIBLE_MASK;
+  }
+
+  constexpr bool operator==(const Move& rhs) const {
+    return _data == rhs._data;
+  }
 
   int score;
 
@@ -83,6 +146,11 @@ class Move {
   static const uint32_t DIRTY_SOURCE_MASK = 0b00100000000000000000000000000000;
   static const uint32_t DIRTY_TARGET_MASK = 0b01000000000000000000000000000000;
   static const uint32_t BEST_POSSIBLE_MASK = 0b10000000000000000000000000000000;
+
+  // what base() leaves in the fields a plain move does not use
+  static const uint32_t UNUSED_FIELDS =
+      (TARGET_TYPE_MASK & (uint32_t(Pawn) << 19)) |
+      (PROMO_TYPE_MASK & (uint32_t(Pawn) << 12)) | EP_FILE_MASK;
 };
 
 std::ostream& operator<<(std::ostream& lhs, const Move& rhs);
@@ -1,33 +1,12 @@
 #include "BitBoard.h"
-#include "Board.h"
 #include "Pawns.h"
 
 namespace BixNix {
 
-Pawns& Pawns::GetInstance() {
-  static Pawns instance;
-  return instance;
-}
-
-Pawns::~Pawns() {
-  // nada
-}
-
-Pawns::Pawns() {
-  // nada
-}
-
 BitBoard Pawns::getAttacksFrom(BitBoard attackers, BitBoard targets,
                                Color color) {
-  BitBoard westAttacks, eastAttacks;
-  if (White == color) {
-    westAttacks = (attackers & notAFile) << 9;
-    eastAttacks = (attackers & notHFile) << 7;
-  } else {
-    westAttacks = (attackers & notAFile) >> 7;
-    eastAttacks = (attackers & notHFile) >> 9;
-  }
-  return (eastAttacks | westAttacks) & targets;
+  if (White == color) return getAttacksFrom<White>(attackers, targets);
+  return getAttacksFrom<Black>(attackers, targets);
 }
 
 BitBoard Pawns::getMovesFrom(BitBoard pawns, BitBoard blockers, Color color) {
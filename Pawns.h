@@ -2,20 +2,24 @@
 #define _PAWNS_H_
 
 #include "BitBoard.h"
-#include "Board.h"
 
 namespace BixNix {
 
 class Pawns {
  public:
-  static Pawns& GetInstance();
-  virtual ~Pawns();
-  BitBoard getAttacksFrom(BitBoard attackers, BitBoard targets, Color color);
-  BitBoard getMovesFrom(BitBoard pawns, BitBoard blockers, Color color);
-  BitBoard getDoublePushesFrom(BitBoard pawns, BitBoard blockers, Color color);
-
- protected:
-  Pawns();
+  static BitBoard getAttacksFrom(BitBoard attackers, BitBoard targets,
+                                 Color color);
+  template <Color color>
+  static BitBoard getAttacksFrom(const BitBoard attackers,
+                                 const BitBoard targets) {
+    return (shift<Side<color>::WEST>(attackers & notAFile) |
+            shift<Side<color>::EAST>(attackers & notHFile)) &
+           targets;
+  }
+  static BitBoard getMovesFrom(BitBoard pawns, BitBoard blockers,
+                               Color color);
+  static BitBoard getDoublePushesFrom(BitBoard pawns, BitBoard blockers,
+                                      Color color);
 };
 }
 
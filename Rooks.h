@@ -1,32 +1,37 @@
 #ifndef _ROOKS_H_
 #define _ROOKS_H_
 
-#include <vector>
 #include <array>
 
 #include "BitBoard.h"
+#include "Sliders.h"
 
 namespace BixNix {
 
 class Rooks {
  public:
-  static Rooks& GetInstance();
-  virtual ~Rooks();
-  BitBoard getAttacksFrom(BitBoard attackers, BitBoard targets,
-                          BitBoard friendlies);
+  static BitBoard getAttacksFrom(BitBoard attackers, BitBoard targets,
+                                 BitBoard friendlies);
 
-  BitBoard getAttacksFrom(Square square, BitBoard targets, BitBoard friendlies);
+  static BitBoard getAttacksFrom(Square square, BitBoard targets,
+                                 BitBoard friendlies) {
+    return _lookup(square, targets | friendlies) & ~friendlies;
+  }
+  // every occupied square blocks, whichever side it belongs to
+  static BitBoard getAttacks(Square square, BitBoard occupied) {
+    return _lookup(square, occupied);
+  }
 
- protected:
-  Rooks();
+  static void setBackend(Sliders::Backend backend);
 
-  std::vector<BitBoard> genOccupancyVariations(Square square);
+ protected:
+  static BitBoard getMagicAttacks(Square square, BitBoard occupied);
+  static BitBoard getPextAttacks(Square square, BitBoard occupied);
+  static BitBoard getObstructionAttacks(Square square, BitBoard occupied);
+  static BitBoard getKoggeStoneAttacks(Square square, BitBoard occupied);
 
-  std::array<BitBoard, 64> _moveMask;
-  std::array<unsigned int, 64> _magicShift;
-  std::array<BitBoard, 64> _magicNumber;
-  std::array<BitBoard*, 64> _magicAttacks;
-  BitBoard* _data;
+  // magics until Sliders makes its choice at startup
+  static BitBoard (*_lookup)(Square square, BitBoard occupied);
 };
 }
 
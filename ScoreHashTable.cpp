@@ -0,0 +1,33 @@
+#include "ScoreHashTable.h"
+
+namespace BixNix {
+
+// entries should be a power of two
+ScoreHashTable::ScoreHashTable(const size_t entries)
+    : _misses(0), _hits(0), _table(entries), _mask(entries - 1) {
+  clear();
+}
+
+// A zeroed entry answers key zero with zero. That is right for the pawn
+// key of a board without pawns, and a full position key is never zero.
+void ScoreHashTable::clear() {
+  for (Entry& entry : _table) entry = 0;
+}
+
+bool ScoreHashTable::get(const ZobristNumber key, Score& score) {
+  const Entry entry = __atomic_load_n(&getEntry(key), __ATOMIC_RELAXED);
+  if ((entry & ~SCORE_BITS) != (key & ~SCORE_BITS)) {
+    ++_misses;
+    return false;
+  }
+  ++_hits;
+  score = static_cast<Score>(entry & SCORE_BITS);
+  return true;
+}
+
+void ScoreHashTable::set(const ZobristNumber key, const Score score) {
+  __atomic_store_n(&getEntry(key),
+                   (key & ~SCORE_BITS) | static_cast<uint16_t>(score),
+                   __ATOMIC_RELAXED);
+}
+}
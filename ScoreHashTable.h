@@ -0,0 +1,47 @@
+//
+// ScoreHashTable.h
+//
+
+#ifndef __SCOREHASHTABLE_H__
+#define __SCOREHASHTABLE_H__
+
+#include <cstddef>
+#include <vector>
+
+#include "Enums.h"
+
+namespace BixNix {
+
+// Caches scores by Zobrist key: pawn structures by Board::getPawnHash()
+// and whole static evaluations by Board::getHash(). Direct mapped and
+// always replacing, since the entry just used is the one worth keeping.
+// Each entry is a single word holding the score under the key's upper
+// bits, read and written whole, so searches sharing the table can never
+// see one position's key with another's score.
+class ScoreHashTable {
+ public:
+  ScoreHashTable(const size_t entries);
+
+  void clear();
+
+  bool get(const ZobristNumber key, Score& score);
+  void set(const ZobristNumber key, const Score score);
+
+  uint64_t _misses;
+  uint64_t _hits;
+
+ private:
+  // the score replaces the key's low bits, which the index mostly checks
+  static const uint64_t SCORE_BITS = 0xFFFF;
+  static_assert(sizeof(Score) * 8 == 16, "Score should fit SCORE_BITS");
+
+  typedef uint64_t Entry;
+
+  Entry& getEntry(const ZobristNumber key) { return _table[key & _mask]; }
+
+  std::vector<Entry> _table;
+  size_t _mask;
+};
+}
+
+#endif  // __SCOREHASHTABLE_H__
@@ -0,0 +1,149 @@
+#include <cpuid.h>
+
+#include <chrono>
+#include <cstdlib>
+#include <random>
+#include <utility>
+#include <vector>
+
+#include "Bishops.h"
+#include "Logger.h"
+#include "Rooks.h"
+#include "Sliders.h"
+
+namespace BixNix {
+
+namespace {
+
+// AMD runs pext in microcode, slower than a magic multiply, before Zen 3.
+bool hasFastPext() {
+  unsigned int eax, ebx, ecx, edx;
+  if (!Sliders::isSupported(Sliders::Pext)) return false;
+  if (!__get_cpuid(0, &eax, &ebx, &ecx, &edx) || signature_AMD_ebx != ebx)
+    return true;
+  __get_cpuid(1, &eax, &ebx, &ecx, &edx);
+  unsigned int family((eax >> 8) & 0xF);
+  if (0xF == family) family += (eax >> 20) & 0xFF;
+  return family >= 0x19;
+}
+}
+
+Sliders& Sliders::GetInstance() {
+  static Sliders instance;
+  return instance;
+}
+
+Sliders::Sliders() : _backend(choose()) { setBackend(_backend); }
+
+namespace {
+// made before main() runs, so the choice is in place before any search
+const Sliders& chosen(Sliders::GetInstance());
+}
+
+Sliders::Backend Sliders::choose() {
+  Backend backend(hasFastPext() ? Pext : Magic);
+  const char* name(getenv("BIXNIX_SLIDERS"));
+  if (nullptr != name) {
+    Backend requested;
+    if (parse(name, requested) && isSupported(requested))
+      backend = requested;
+    else
+      LOG(trace) << "BIXNIX_SLIDERS=" << name << " is not available here";
+  }
+  LOG(trace) << "sliding attacks by " << getName(backend);
+  return backend;
+}
+
+bool Sliders::isSupported(const Backend backend) {
+  switch (backend) {
+    case Pext:
+      return __builtin_cpu_supports("bmi2");
+    case Magic:
+    case ObstructionDifference:
+    case KoggeStone:
+      return true;
+    default:
+      return false;
+  }
+}
+
+const char* Sliders::getName(const Backend backend) {
+  switch (backend) {
+    case Magic:
+      return "magic";
+    case Pext:
+      return "pext";
+    case ObstructionDifference:
+      return "obstruction";
+    case KoggeStone:
+      return "koggestone";
+    default:
+      return "unknown";
+  }
+}
+
+bool Sliders::parse(const std::string& name, Backend& backend) {
+  for (int candidate = 0; candidate < BACKENDS; ++candidate) {
+    if (name == getName(Backend(candidate))) {
+      backend = Backend(candidate);
+      return true;
+    }
+  }
+  return false;
+}
+
+bool Sliders::setBackend(const Backend backend) {
+  if (!isSupported(backend)) return false;
+  _backend = backend;
+  Bishops::setBackend(backend);
+  Rooks::setBackend(backend);
+  return true;
+}
+
+// Each lookup is one bishop and one rook from a random square through a
+// board about a quarter full. The results are folded together, both so
+// the lookups cannot be optimized away and to check the backends agree.
+Sliders::Backend Sliders::benchmark(const size_t lookups) {
+  static const size_t QUERIES = 4096;
+  std::mt19937_64 random(QUERIES);
+  std::vector<std::pair<Square, BitBoard>> queries(QUERIES);
+  for (auto& query : queries)
+    query = std::make_pair(Square(random() & 63), random() & random());
+
+  const Backend previous(_backend);
+  Backend fastest(previous);
+  double fastestRate(0.0);
+  BitBoard expected(0LL);
+  bool first(true);
+
+  for (int candidate = 0; candidate < BACKENDS; ++candidate) {
+    const Backend backend(static_cast<Backend>(candidate));
+    if (!setBackend(backend)) continue;
+
+    BitBoard folded(0LL);
+    const auto start(std::chrono::steady_clock::now());
+    for (size_t i = 0; i < lookups; ++i) {
+      const auto& query(queries[i & (QUERIES - 1)]);
+      folded += Bishops::getAttacks(query.first, query.second) ^
+                Rooks::getAttacks(query.first, query.second);
+    }
+    const std::chrono::duration<double> elapsed(
+        std::chrono::steady_clock::now() - start);
+
+    const double rate(lookups / elapsed.count() / 1e6);
+    LOG(trace) << getName(backend) << ": " << rate << "M lookups/s";
+    if (first)
+      expected = folded;
+    else if (folded != expected)
+      LOG(trace) << getName(backend) << " disagrees with magic";
+    first = false;
+    if (rate > fastestRate) {
+      fastestRate = rate;
+      fastest = backend;
+    }
+  }
+
+  setBackend(previous);
+  return fastest;
+}
+}
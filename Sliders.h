@@ -0,0 +1,49 @@
+#ifndef _SLIDERS_H_
+#define _SLIDERS_H_
+
+#include <string>
+
+#include "BitBoard.h"
+
+namespace BixNix {
+
+// Which way Bishops and Rooks work out sliding attacks. They all give the
+// same answers; which is fastest depends on the machine, so the choice is
+// made once at startup from what the CPU reports, unless the BIXNIX_SLIDERS
+// environment variable names one.
+class Sliders {
+ public:
+  enum Backend {
+    Magic,                  // multiply-and-shift indexed tables
+    Pext,                   // tables indexed by BMI2's pext instruction
+    ObstructionDifference,  // subtraction along each line, no tables
+    KoggeStone,             // the smears from BitBoard.h, no tables
+    BACKENDS
+  };
+
+  static Sliders& GetInstance();
+  virtual ~Sliders() {}
+
+  static bool isSupported(const Backend backend);
+  static const char* getName(const Backend backend);
+  static bool parse(const std::string& name, Backend& backend);
+
+  Backend getBackend() const { return _backend; }
+  // false, changing nothing, if the CPU cannot run it
+  bool setBackend(const Backend backend);
+
+  // Times every backend this CPU supports on the same random lookups and
+  // logs each one's rate. The backend in use is left as it was; the
+  // fastest one is returned.
+  Backend benchmark(const size_t lookups = 1 << 22);
+
+ protected:
+  Sliders();
+
+  static Backend choose();
+
+  Backend _backend;
+};
+}
+
+#endif  // _SLIDERS_H_
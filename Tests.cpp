@@ -0,0 +1,201 @@
+#include <stdlib.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <cstdint>
+#include <sstream>
+#include <string>
+
+#include "AnalysisStore.h"
+#include "Board.h"
+#include "Engine.h"
+#include "Logger.h"
+#include "Tests.h"
+#include "TranspositionTable.h"
+
+namespace BixNix {
+
+namespace {
+
+const char* FOOLS_MATE =
+    "rnb1kbnr/pppp1ppp/8/4p3/6Pq/5P2/PPPPP2P/RNBQKBNR w KQkq -";
+
+Board parse(const char* epd) {
+  std::istringstream in(epd);
+  return Board::parseEPD(in);
+}
+
+// splitmix64, to spread test keys over the buckets
+ZobristNumber getTestKey(uint64_t index) {
+  index = (index + 0x9E3779B97F4A7C15ULL) * 0xBF58476D1CE4E5B9ULL;
+  index = (index ^ (index >> 30)) * 0x94D049BB133111EBULL;
+  return index ^ (index >> 31);
+}
+}
+
+bool Tests::run() {
+  bool passed = true;
+  passed &= perftRepeats();
+  passed &= searchDefaultLimits();
+  passed &= searchNoMoves();
+  passed &= storeNoMoves();
+  passed &= sharedTable();
+  LOG(info) << "tests " << (passed ? "passed" : "FAILED");
+  return passed;
+}
+
+bool Tests::perftRepeats() {
+  // exf6 en passant is the 31st move
+  std::istringstream epd(
+      "rnbqkbnr/ppp1p1pp/8/3pPp2/8/8/PPPP1PPP/RNBQKBNR w KQkq f6");
+  Board board(Board::parseEPD(epd));
+  const ZobristNumber hash(board.getHash());
+  const uint64_t deep(board.perft(3));
+  for (int run = 0; run < 2; ++run) {
+    if (31 != board.perft(1) || deep != board.perft(3) ||
+        hash != board.getHash()) {
+      LOG(error) << "perft from an en passant EPD changed on run " << run;
+      return false;
+    }
+  }
+  return true;
+}
+
+bool Tests::searchDefaultLimits() {
+  Engine engine(16);
+  const Engine::SearchResult result(
+      engine.searchPosition(Board::initial(), Engine::SearchLimits()));
+  if (Engine::DEFAULT_DEPTH != result.depth || Move(0) == result.move) {
+    LOG(error) << "search with default limits stopped at depth "
+               << int(result.depth);
+    return false;
+  }
+  return true;
+}
+
+bool Tests::searchNoMoves() {
+  Engine engine(16);
+  Engine::SearchLimits limits;
+  limits.depth = 4;
+  engine.searchPosition(Board::initial(), limits);
+
+  // fool's mate, then a queen stalemating a cornered king
+  const struct {
+    const char* epd;
+    Score score;
+  } ends[] = {
+      {FOOLS_MATE, -CHECKMATE}, {"7k/5Q2/6K1/8/8/8/8/8 b - -", DRAW},
+  };
+  for (const auto& end : ends) {
+    const Engine::SearchResult result(
+        engine.searchPosition(parse(end.epd), limits));
+    if (Move(0) != result.move || end.score != result.score ||
+        0 != result.depth) {
+      LOG(error) << "search of " << end.epd << " returned " << result.move
+                 << " (" << result.score << ") at depth "
+                 << int(result.depth);
+      return false;
+    }
+  }
+  return true;
+}
+
+bool Tests::storeNoMoves() {
+  char path[] = "/tmp/bixnix-store-XXXXXX";
+  const int fd = mkstemp(path);
+  if (fd < 0) {
+    LOG(error) << "no temporary file for the analysis store";
+    return false;
+  }
+  close(fd);
+
+  {
+    Engine engine(16);
+    Engine::SearchLimits limits;
+    limits.depth = Engine::STORE_DEPTH;
+    engine.openStore(path);
+    engine.searchPosition(Board::initial(), limits);
+    engine.searchPosition(parse(FOOLS_MATE), limits);
+    engine.closeStore();
+  }
+
+  AnalysisStore store;
+  AnalysisStore::Record record;
+  const bool opened = store.open(path);
+  const bool kept = opened && store.find(Board::initial(), record);
+  const bool mated = opened && store.find(parse(FOOLS_MATE), record);
+  store.close();
+  unlink(path);
+  if (!kept) LOG(error) << "analysis store lost the start position";
+  if (mated) LOG(error) << "analysis store has a result for a mated root";
+  return kept && !mated;
+}
+
+// Each child stores its own keys, then the parent must find every one.
+bool Tests::sharedTable() {
+  const int PROCESSES = 3;
+  const int KEYS = 500;
+  const Depth DEPTH = 4;
+  const std::string name("bixnix-tests-" + std::to_string(getpid()));
+
+  TranspositionTable table;
+  if (!table.share(name, 1)) {
+    LOG(error) << "could not share a transposition table as " << name;
+    return false;
+  }
+
+  pid_t children[PROCESSES];
+  for (int child = 0; child < PROCESSES; ++child) {
+    children[child] = fork();
+    if (0 != children[child]) continue;
+
+    TranspositionTable mine;
+    if (!mine.share(name, 1)) _exit(1);
+    for (int i = 0; i < KEYS; ++i) {
+      const int index = child * KEYS + i;
+      mine.set(getTestKey(index), DEPTH, -CHECKMATE, CHECKMATE,
+               Score(index % 1000), Move(index + 1));
+    }
+    _exit(0);
+  }
+
+  bool passed = true;
+  for (int child = 0; child < PROCESSES; ++child) {
+    int status = 0;
+    const bool waited = children[child] > 0 &&
+                        children[child] == waitpid(children[child], &status, 0);
+    if (!waited || !WIFEXITED(status) || 0 != WEXITSTATUS(status)) {
+      LOG(error) << "process " << child << " sharing " << name << " failed";
+      passed = false;
+    }
+  }
+
+  table.resetStats();
+  int found = 0;
+  for (int index = 0; index < PROCESSES * KEYS; ++index) {
+    Score alpha(-CHECKMATE), beta(CHECKMATE), score(0);
+    Move move;
+    if (table.get(getTestKey(index), DEPTH, alpha, beta, score, move) &&
+        Score(index % 1000) == score && Move(index + 1) == move)
+      ++found;
+  }
+  const TranspositionTable::Stats& stats(table.getStats());
+  if (PROCESSES * KEYS != found ||
+      uint64_t(found) != stats.hits[int(MTDFTTNode::Type::Exact)] ||
+      0 != stats.misses) {
+    LOG(error) << "found " << found << " of " << PROCESSES * KEYS
+               << " results stored through " << name << ", "
+               << stats.misses << " misses";
+    passed = false;
+  }
+
+  table.resize(1);
+  if (table.isShared()) {
+    LOG(error) << "resize() kept the table shared as " << name;
+    passed = false;
+  }
+
+  TranspositionTable::unlinkShared(name);
+  return passed;
+}
+}
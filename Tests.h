@@ -0,0 +1,27 @@
+#ifndef _TESTS_H_
+#define _TESTS_H_
+
+namespace BixNix {
+
+// What `chess --test` runs. Each check logs what went wrong and returns
+// false if it failed; run() goes through all of them.
+class Tests {
+ public:
+  static bool run();
+
+ protected:
+  // perft from an EPD with an en passant square, repeated, must neither
+  // change its count nor leave the position changed behind it
+  static bool perftRepeats();
+  // a synchronous search left with the default limits must still finish
+  static bool searchDefaultLimits();
+  // a root without moves must not report the previous search's result
+  static bool searchNoMoves();
+  // nor may it store a result for that root in an open analysis store
+  static bool storeNoMoves();
+  // processes sharing one transposition table see each other's results
+  static bool sharedTable();
+};
+}
+
+#endif  // _TESTS_H_
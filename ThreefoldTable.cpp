@@ -1,19 +1,17 @@
+#include <algorithm>
+
 #include "ThreefoldTable.h"
 
 namespace BixNix {
 
-void ThreefoldTable::add(const ZobristNumber key) { _table[key] += 1; }
-
-void ThreefoldTable::remove(const ZobristNumber key) {
-  auto it = _table.find(key);
-  if (it == _table.end()) return;
-  it->second -= 1;
-  if (it->second == 0) _table.erase(it);
-}
-
-bool ThreefoldTable::addWouldTrigger(const ZobristNumber key) const {
-  auto it = _table.find(key);
-  if (it == _table.end()) return false;
-  return it->second > 1;
+// Only positions with the same side to move can match, so step back two
+// plies at a time, and stop at the last irreversible move.
+bool ThreefoldTable::addWouldTrigger(const ZobristNumber key,
+                                     const int reversible) const {
+  const size_t depth = std::min(size_t(std::max(reversible, 0)), _ply);
+  int seen = 0;
+  for (size_t back = 2; back <= depth; back += 2)
+    if (_keys[(_ply - back) & (SIZE - 1)] == key && ++seen > 1) return true;
+  return false;
 }
 }
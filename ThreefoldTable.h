@@ -1,19 +1,41 @@
 #ifndef __THREEFOLDTABLE_H__
 #define __THREEFOLDTABLE_H__
 
-#include <unordered_map>
+#include <array>
+#include <cstddef>
 
 #include "Enums.h"
 
 namespace BixNix {
 
+// Keys of the positions along the game and the current search line, one
+// per ply. A position can only recur since the last capture or pawn move,
+// at most 100 plies back, so a ring of the latest keys is all it needs.
 class ThreefoldTable {
  public:
-  void add(const ZobristNumber key);
-  void remove(const ZobristNumber key);
-  bool addWouldTrigger(const ZobristNumber key) const;
+  static const size_t SIZE = 256;
 
-  std::unordered_map<ZobristNumber, uint8_t> _table;
+  ThreefoldTable() : _ply(0) {}
+
+  void clear() { _ply = 0; }
+  void add(const ZobristNumber key) { _keys[_ply++ & (SIZE - 1)] = key; }
+  void remove() { --_ply; }
+
+  // reversible is Board::getReversiblePlies() for the position with key
+  bool addWouldTrigger(const ZobristNumber key, const int reversible) const;
+
+  size_t size() const { return _ply; }
+  // back plies before the latest key, which is getKey(0)
+  ZobristNumber getKey(const size_t back) const {
+    return _keys[(_ply - 1 - back) & (SIZE - 1)];
+  }
+
+ private:
+  static_assert(SIZE > 100 + HEIGHTMAX,
+                "ThreefoldTable should span 100 plies and a search line");
+
+  std::array<ZobristNumber, SIZE> _keys;
+  size_t _ply;
 };
 }
 
@@ -1,100 +1,680 @@
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <thread>
+#include <vector>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
 #include "TranspositionTable.h"
+#include "Zobrist.h"
 
 namespace BixNix {
 
+namespace {
+
+bool writeAll(const int fd, const char* data, size_t bytes) {
+  while (bytes > 0) {
+    const ssize_t written = write(fd, data, bytes);
+    if (written < 0 && EINTR == errno) continue;
+    if (written <= 0) return false;
+    data += written;
+    bytes -= written;
+  }
+  return true;
+}
+
+bool readAll(const int fd, void* buffer, size_t bytes) {
+  char* data = static_cast<char*>(buffer);
+  while (bytes > 0) {
+    const ssize_t got = read(fd, data, bytes);
+    if (got < 0 && EINTR == errno) continue;
+    if (got <= 0) return false;
+    data += got;
+    bytes -= got;
+  }
+  return true;
+}
+
+// shm_open() names are a single path component with a leading slash.
+std::string getSharedPath(const std::string& name) {
+  return (!name.empty() && '/' == name[0]) ? name : '/' + name;
+}
+}
+
+const size_t TranspositionTable::FILE_CHUNK_BYTES;
+
 TranspositionTable::TranspositionTable()
-    : _collisions(0), _misses(0), _hits(0), _size(0), _table(nullptr) {}
+    : _stats(),
+      _buckets(0),
+      _generation(0),
+      _sharedGeneration(nullptr),
+      _table(nullptr),
+      _mapping(nullptr),
+      _mappingBytes(0),
+      _hugePages(false),
+      _zeroed(false),
+      _shared(false),
+      _hotBuckets(0),
+      _hotDepth(0),
+      _hot(nullptr) {}
 
-TranspositionTable::TranspositionTable(const size_t size)
-    : _collisions(0),
-      _misses(0),
-      _hits(0),
-      _size(size),
-      _maxOccupancy(0),
-      _table(new MTDFTTNode[size]) {
-  clear();
+TranspositionTable::TranspositionTable(const size_t megabytes)
+    : TranspositionTable() {
+  resize(megabytes);
 }
 
 TranspositionTable::~TranspositionTable() {
-  if (nullptr == _table) {
-    delete[] _table;
-    _table = nullptr;
+  release();
+  resizeHot(0, 0);
+}
+
+// Fresh anonymous mappings are already zeroed, so there is nothing to clear
+// and pages are only faulted in as the search reaches them.
+void TranspositionTable::resize(const size_t megabytes) {
+  if (_shared) release();
+  resizeBuckets((megabytes << 20) / sizeof(Bucket));
+}
+
+void TranspositionTable::resizeBuckets(const size_t buckets) {
+  if (buckets == _buckets) {
+    clear();
+    return;
+  }
+
+  release();
+  allocate(buckets * sizeof(Bucket));
+  _buckets = buckets;
+  _generation = 0;
+  _zeroed = true;
+#ifdef TTABLE_VERIFY
+  _verify.assign(_buckets * Bucket::SIZE, 0);
+#endif
+}
+
+// Sized to stay in L2, so the probes near the root that decide the search
+// stay cheap, and the depth floor keeps leaf results from churning it.
+// Everything it holds is also in the main table, so it is never saved.
+void TranspositionTable::resizeHot(const size_t kilobytes,
+                                   const Depth minDepth) {
+  std::free(_hot);
+  _hot = nullptr;
+  _hotBuckets = (kilobytes << 10) / sizeof(Bucket);
+  _hotDepth = minDepth;
+  if (0 == _hotBuckets) return;
+
+  void* hot = nullptr;
+  if (0 != posix_memalign(&hot, sizeof(Bucket), _hotBuckets * sizeof(Bucket))) {
+    _hotBuckets = 0;
+    throw std::bad_alloc();
   }
+  _hot = static_cast<Bucket*>(hot);
+  std::memset(_hot, 0, _hotBuckets * sizeof(Bucket));
 }
 
-void TranspositionTable::resize(const size_t size) {
-  if (nullptr == _table) {
-    delete[] _table;
-    _table = nullptr;
+// Tries an explicit huge page mapping from the hugetlbfs pool first. Most
+// boxes have no pool reserved, so fall back to ordinary pages, aligned so
+// that transparent huge pages can back the whole table.
+void TranspositionTable::allocate(const size_t bytes) {
+  const size_t rounded =
+      (bytes + HUGE_PAGE_SIZE - 1) / HUGE_PAGE_SIZE * HUGE_PAGE_SIZE;
+
+#ifdef MAP_HUGETLB
+  _mapping = mmap(nullptr, rounded, PROT_READ | PROT_WRITE,
+                  MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+  if (MAP_FAILED != _mapping) {
+    _mappingBytes = rounded;
+    _hugePages = true;
+    _table = static_cast<Bucket*>(_mapping);
+    return;
   }
+#endif
 
-  _size = size;
-  _table = new MTDFTTNode[size];
+  _mappingBytes = rounded + HUGE_PAGE_SIZE;
+  _mapping = mmap(nullptr, _mappingBytes, PROT_READ | PROT_WRITE,
+                  MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (MAP_FAILED == _mapping) {
+    _mapping = nullptr;
+    _mappingBytes = 0;
+    throw std::bad_alloc();
+  }
 
-  clear();
+  const uintptr_t address = reinterpret_cast<uintptr_t>(_mapping);
+  const uintptr_t aligned =
+      (address + HUGE_PAGE_SIZE - 1) / HUGE_PAGE_SIZE * HUGE_PAGE_SIZE;
+  _table = reinterpret_cast<Bucket*>(aligned);
+  _hugePages = false;
+#ifdef MADV_HUGEPAGE
+  _hugePages = (0 == madvise(_table, rounded, MADV_HUGEPAGE));
+#endif
 }
 
-void TranspositionTable::clear() {
-  size_t occupancy = 0;
-  for (size_t i = 0; i < _size; ++i)
-    if (_table[i]._hash != 0xFFFFFFFFFFFFFFFFLL) ++occupancy;
-  _maxOccupancy = std::max(_maxOccupancy, occupancy);
+void TranspositionTable::release() {
+  if (nullptr != _mapping) {
+    munmap(_mapping, _mappingBytes);
+    _mapping = nullptr;
+    _mappingBytes = 0;
+  }
+  _table = nullptr;
+  _buckets = 0;
+  _hugePages = false;
+  _shared = false;
+  _sharedGeneration = nullptr;
+}
 
-  for (size_t i = 0; i < _size; ++i) _table[i]._hash = 0xFFFFFFFFFFFFFFFFLL;
+bool TranspositionTable::validate(const FileHeader& header,
+                                  const size_t bytes) const {
+  return FileHeader::MAGIC == header._magic &&
+         FileHeader::VERSION == header._version &&
+         sizeof(Bucket) == header._bucketBytes &&
+         Zobrist::SEED == header._zobristSeed &&
+         bytes == FileHeader::PAGE + header._buckets * sizeof(Bucket);
 }
 
-bool TranspositionTable::get(const ZobristNumber key, const Depth priority,
-                             Score& alpha, Score& beta, Score& score,
-                             Move& move) {
-  MTDFTTNode& node = _table[key % _size];
-  if (node._hash == key && node._depth >= priority) {
-    ++_hits;
-    move = node._move;
-    switch (node._type) {
-      case MTDFTTNode::Type::Exact:
-        score = node._score;
-        return true;
-        break;
-      case MTDFTTNode::Type::Lower:
-        alpha = std::max(alpha, node._score);
-        break;
-      case MTDFTTNode::Type::Upper:
-        beta = std::min(beta, node._score);
+// Whoever creates the segment sizes it and fills in the header, publishing
+// _magic last; everyone else waits for that and adopts its size. Buckets
+// are read and written without locks, relying on getCheck() to turn torn
+// entries into misses. Each process keeps its own hot table and
+// statistics, but the generation lives in the header, so entries another
+// process stored during the current search don't look stale.
+bool TranspositionTable::share(const std::string& name,
+                               const size_t megabytes) {
+  const std::string path(getSharedPath(name));
+  bool created = true;
+  int fd = shm_open(path.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+  if (fd < 0 && EEXIST == errno) {
+    created = false;
+    fd = shm_open(path.c_str(), O_RDWR, 0);
+  }
+  if (fd < 0) return false;
+
+  size_t bytes = 0;
+  if (created) {
+    const size_t buckets = (megabytes << 20) / sizeof(Bucket);
+    bytes = FileHeader::PAGE + buckets * sizeof(Bucket);
+    if (0 != ftruncate(fd, bytes)) bytes = 0;
+  } else {
+    struct stat status;
+    for (int tries = 0; tries < SHARE_WAIT_TRIES; ++tries) {
+      if (0 != fstat(fd, &status)) break;
+      if (size_t(status.st_size) > FileHeader::PAGE) {
+        bytes = status.st_size;
         break;
+      }
+      usleep(SHARE_WAIT_MICROSECONDS);
+    }
+  }
+
+  void* mapping = MAP_FAILED;
+  if (bytes > 0)
+    mapping = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  close(fd);
+  if (MAP_FAILED == mapping) {
+    if (created) shm_unlink(path.c_str());
+    return false;
+  }
+
+  FileHeader& header = *static_cast<FileHeader*>(mapping);
+  if (created) {
+    header._version = FileHeader::VERSION;
+    header._bucketBytes = sizeof(Bucket);
+    header._buckets = (bytes - FileHeader::PAGE) / sizeof(Bucket);
+    header._zobristSeed = Zobrist::SEED;
+    header._generation = 0;
+    __atomic_store_n(&header._magic, FileHeader::MAGIC, __ATOMIC_RELEASE);
+  } else {
+    for (int tries = 0; tries < SHARE_WAIT_TRIES &&
+                        FileHeader::MAGIC !=
+                            __atomic_load_n(&header._magic, __ATOMIC_ACQUIRE);
+         ++tries)
+      usleep(SHARE_WAIT_MICROSECONDS);
+  }
+
+  if (!validate(header, bytes)) {
+    munmap(mapping, bytes);
+    return false;
+  }
+
+  release();
+  _mapping = mapping;
+  _mappingBytes = bytes;
+  _table = reinterpret_cast<Bucket*>(static_cast<char*>(mapping) +
+                                     FileHeader::PAGE);
+  _buckets = header._buckets;
+  _sharedGeneration = &header._generation;
+  syncGeneration();
+  _zeroed = false;
+  _shared = true;
+  if (nullptr != _hot) std::memset(_hot, 0, _hotBuckets * sizeof(Bucket));
+#ifdef TTABLE_VERIFY
+  _verify.assign(_buckets * Bucket::SIZE, 0);
+#endif
+  return true;
+}
+
+// The segment lives on until every process sharing it has unmapped it.
+bool TranspositionTable::unlinkShared(const std::string& name) {
+  return 0 == shm_unlink(getSharedPath(name).c_str());
+}
+
+// Only needed for a new game; between moves call newSearch() instead.
+// Large tables are split across every core. A shared table keeps its
+// buckets and generation, which other processes may still be searching
+// with.
+void TranspositionTable::clear() {
+  _generation = 0;
+  syncGeneration();
+  if (nullptr != _hot) std::memset(_hot, 0, _hotBuckets * sizeof(Bucket));
+#ifdef TTABLE_VERIFY
+  std::fill(_verify.begin(), _verify.end(), 0);
+#endif
+  // skip faulting in every page of a table nothing has been stored in
+  if (_zeroed || _shared) return;
+
+  size_t threadCount = 1;
+  if (_buckets * sizeof(Bucket) >= PARALLEL_CLEAR_BYTES)
+    threadCount = std::max(1u, std::thread::hardware_concurrency());
+
+  const size_t chunk = (_buckets + threadCount - 1) / threadCount;
+  auto clearChunk = [&](const size_t index) {
+    const size_t begin = std::min(_buckets, index * chunk);
+    const size_t end = std::min(_buckets, begin + chunk);
+    std::memset(_table + begin, 0, (end - begin) * sizeof(Bucket));
+  };
+
+  std::vector<std::thread> workers;
+  for (size_t i = 1; i < threadCount; ++i)
+    workers.emplace_back(clearChunk, i);
+  clearChunk(0);
+  for (std::thread& worker : workers) worker.join();
+
+  _zeroed = true;
+}
+
+void TranspositionTable::resetStats() { _stats = Stats(); }
+
+// Streams the table straight from its own memory, through a temporary file
+// so an interrupted save never clobbers the previous one.
+bool TranspositionTable::save(const std::string& path) const {
+  if (nullptr == _table) return false;
+
+  const std::string temporary(path + ".tmp");
+  const int fd = open(temporary.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (fd < 0) return false;
+
+  std::vector<char> page(FileHeader::PAGE, 0);
+  FileHeader& header = *reinterpret_cast<FileHeader*>(page.data());
+  header._magic = FileHeader::MAGIC;
+  header._version = FileHeader::VERSION;
+  header._bucketBytes = sizeof(Bucket);
+  header._buckets = _buckets;
+  header._zobristSeed = Zobrist::SEED;
+  header._generation = _generation;
+
+  bool success = writeAll(fd, page.data(), page.size());
+  const char* data = reinterpret_cast<const char*>(_table);
+  const size_t bytes = _buckets * sizeof(Bucket);
+  for (size_t offset = 0; success && offset < bytes; offset += FILE_CHUNK_BYTES)
+    success = writeAll(fd, data + offset,
+                       std::min(FILE_CHUNK_BYTES, bytes - offset));
+
+  success = (0 == close(fd)) && success;
+  if (success) success = (0 == rename(temporary.c_str(), path.c_str()));
+  if (!success) unlink(temporary.c_str());
+  return success;
+}
+
+// Reads the buckets directly into a table resized to match the file. A
+// file written by a different format or Zobrist seed is refused before the
+// current table is touched; a short read leaves the table cleared. A shared
+// table is loaded in place for every process, so its size must match.
+bool TranspositionTable::load(const std::string& path) {
+  const int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0) return false;
+
+  FileHeader header;
+  struct stat status;
+  bool success = readAll(fd, &header, sizeof(header)) &&
+                 (0 == fstat(fd, &status)) &&
+                 validate(header, status.st_size) &&
+                 (!_shared || header._buckets == _buckets) &&
+                 (off_t)FileHeader::PAGE == lseek(fd, FileHeader::PAGE, SEEK_SET);
+
+  if (success) {
+    resizeBuckets(header._buckets);
+    if (nullptr != _hot) std::memset(_hot, 0, _hotBuckets * sizeof(Bucket));
+    char* data = reinterpret_cast<char*>(_table);
+    const size_t bytes = _buckets * sizeof(Bucket);
+    for (size_t offset = 0; success && offset < bytes;
+         offset += FILE_CHUNK_BYTES)
+      success = readAll(fd, data + offset,
+                        std::min(FILE_CHUNK_BYTES, bytes - offset));
+
+    _zeroed = false;
+    if (success) {
+      _generation = header._generation % GENERATIONS;
+      if (nullptr != _sharedGeneration)
+        __atomic_store_n(_sharedGeneration, _generation, __ATOMIC_RELAXED);
+    } else {
+      clear();
+    }
+  }
+
+  close(fd);
+  return success;
+}
+
+// Entries from earlier searches stay usable, but become the first to be
+// overwritten. Processes sharing the table that start the same search
+// together only advance the shared generation once between them.
+void TranspositionTable::newSearch() {
+  uint8_t next = (_generation + 1) % GENERATIONS;
+  if (nullptr != _sharedGeneration &&
+      !__atomic_compare_exchange_n(_sharedGeneration, &_generation, next,
+                                   false, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+    next = _generation;
+  _generation = next;
+}
+
+int TranspositionTable::find(const Bucket& bucket,
+                             const uint32_t fragment) const {
+  unsigned int matches = 0;
+#ifdef __SSE2__
+  // the first four nodes as two registers of low and high halves
+  const __m128 nodes01 =
+      _mm_load_ps(reinterpret_cast<const float*>(&bucket._nodes[0]));
+  const __m128 nodes23 =
+      _mm_load_ps(reinterpret_cast<const float*>(&bucket._nodes[2]));
+  const __m128i checks = _mm_xor_si128(
+      _mm_castps_si128(
+          _mm_shuffle_ps(nodes01, nodes23, _MM_SHUFFLE(2, 0, 2, 0))),
+      _mm_castps_si128(
+          _mm_shuffle_ps(nodes01, nodes23, _MM_SHUFFLE(3, 1, 3, 1))));
+  const __m128i keys = _mm_xor_si128(
+      checks, _mm_loadu_si128(reinterpret_cast<const __m128i*>(bucket._keys)));
+  const __m128i equal = _mm_cmpeq_epi32(keys, _mm_set1_epi32(fragment));
+  matches = _mm_movemask_ps(_mm_castsi128_ps(equal));
+  for (int i = 4; i < Bucket::SIZE; ++i)
+    if ((bucket._keys[i] ^ getCheck(bucket._nodes[i])) == fragment)
+      matches |= (1u << i);
+#else
+  for (int i = 0; i < Bucket::SIZE; ++i)
+    if ((bucket._keys[i] ^ getCheck(bucket._nodes[i])) == fragment)
+      matches |= (1u << i);
+#endif
+
+  while (0 != matches) {
+    const int slot = __builtin_ctz(matches);
+    if (!bucket._nodes[slot].empty()) return slot;
+    matches &= matches - 1;
+  }
+  return -1;
+}
+
+// Empty slots first, then the shallowest depth slot, preferring nodes left
+// over from earlier searches. If even that one is deeper than the newcomer
+// and still current, the newcomer goes to the always-replace slot.
+int TranspositionTable::getVictim(const Bucket& bucket,
+                                  const Depth priority) const {
+  int victim = 0;
+  int victimWorth = std::numeric_limits<int>::max();
+  for (int i = 0; i < Bucket::DEPTH_SLOTS; ++i) {
+    const MTDFTTNode& node = bucket._nodes[i];
+    if (node.empty()) return i;
+    int worth = node._depth;
+    if (node._generation == _generation) worth += HEIGHTMAX;
+    if (worth < victimWorth) {
+      victim = i;
+      victimWorth = worth;
     }
-    if (alpha >= beta) {
+  }
+
+  const MTDFTTNode& node = bucket._nodes[victim];
+  if (node._generation == _generation && node._depth > priority)
+    return Bucket::SIZE - 1;
+  return victim;
+}
+
+bool TranspositionTable::probe(const MTDFTTNode& node, Score& alpha,
+                               Score& beta, Score& score, Move& move) const {
+  move = node._move;
+  switch (MTDFTTNode::Type(node._type)) {
+    case MTDFTTNode::Type::Exact:
       score = node._score;
       return true;
+      break;
+    case MTDFTTNode::Type::Lower:
+      alpha = std::max(alpha, node._score);
+      break;
+    case MTDFTTNode::Type::Upper:
+      beta = std::min(beta, node._score);
+      break;
+    case MTDFTTNode::Type::Empty:
+      break;
+  }
+  if (alpha >= beta) {
+    score = node._score;
+    return true;
+  }
+  return false;
+}
+
+// Only nodes at least _hotDepth deep can answer a probe that deep, so those
+// look in the hot table first and never touch the main one on a hit.
+bool TranspositionTable::get(const ZobristNumber key, const Depth priority,
+                             Score& alpha, Score& beta, Score& score,
+                             Move& move) {
+  syncGeneration();
+  const uint32_t fragment = getFragment(key);
+  if (nullptr != _hot && priority >= _hotDepth) {
+    Bucket& hot = getHotBucket(key);
+    const int slot = find(hot, fragment);
+    if (slot >= 0 && hot._nodes[slot]._depth >= priority) {
+      ++_stats.hotHits;
+      MTDFTTNode node(hot._nodes[slot]);
+      if (node._generation != _generation) {
+        node._generation = _generation;
+        write(hot, slot, fragment, node);
+      }
+      return probe(node, alpha, beta, score, move);
     }
+    ++_stats.hotMisses;
+  }
+
+  Bucket& bucket = getBucket(key);
+  const int slot = find(bucket, fragment);
+  // copied and checked again, as another process may be writing the slot
+  MTDFTTNode node;
+  if (slot >= 0) node = bucket._nodes[slot];
+  if (slot < 0 || (bucket._keys[slot] ^ getCheck(node)) != fragment) {
+    ++_stats.misses;
+    return false;
+  }
+
+#ifdef TTABLE_VERIFY
+  const ZobristNumber stored = _verify[(&bucket - _table) * Bucket::SIZE + slot];
+  if (0 != stored && key != stored) ++_stats.falsePositives;
+#endif
+
+  // only entries from earlier searches need their cache line written
+  if (node._generation != _generation) {
+    node._generation = _generation;
+    write(bucket, slot, fragment, node);
+  }
+  if (node._depth >= priority) {
+    ++_stats.hits[node._type];
+    const bool cutoff = probe(node, alpha, beta, score, move);
+    if (cutoff) ++_stats.cutoffs[node._type];
+    return cutoff;
   } else
-    ++_misses;
+    ++_stats.shallow;
 
   return false;
 }
 
+// Current results outrank stale ones, then deeper ones, and at equal depth
+// an exact score from the principal variation beats a bound.
+int TranspositionTable::getHotWorth(const MTDFTTNode& node) const {
+  int worth = 2 * node._depth;
+  if (MTDFTTNode::Type(node._type) == MTDFTTNode::Type::Exact) ++worth;
+  if (node._generation == _generation) worth += 2 * HEIGHTMAX;
+  return worth;
+}
+
+// Unlike the main table there is no always-replace slot: a newcomer only
+// displaces the least worthy node if it is worth at least as much.
+void TranspositionTable::setHot(const ZobristNumber key,
+                                const MTDFTTNode& node) {
+  Bucket& bucket = getHotBucket(key);
+  const uint32_t fragment = getFragment(key);
+  int slot = find(bucket, fragment);
+  if (slot >= 0) {
+    if (bucket._nodes[slot]._depth > node._depth) {
+      MTDFTTNode refreshed(bucket._nodes[slot]);
+      if (refreshed._generation != _generation) {
+        refreshed._generation = _generation;
+        write(bucket, slot, fragment, refreshed);
+      }
+      return;
+    }
+  } else {
+    slot = 0;
+    for (int i = 0; i < Bucket::SIZE; ++i) {
+      if (bucket._nodes[i].empty()) {
+        slot = i;
+        break;
+      }
+      if (getHotWorth(bucket._nodes[i]) < getHotWorth(bucket._nodes[slot]))
+        slot = i;
+    }
+    if (!bucket._nodes[slot].empty()) {
+      if (getHotWorth(bucket._nodes[slot]) > getHotWorth(node)) {
+        ++_stats.hotRejections;
+        return;
+      }
+      ++_stats.hotReplacements;
+    }
+  }
+
+  write(bucket, slot, fragment, node);
+}
+
 bool TranspositionTable::set(const ZobristNumber key, const Depth priority,
                              const Score alpha, const Score beta,
                              const Score score, const Move& move) {
-  MTDFTTNode& node = _table[key % _size];
-  if (node._hash != 0xFFFFFFFFFFFFFFFFLL && node._hash != key) ++_collisions;
-
-  if (key != node._hash || node._depth < priority) {
-    node._hash = key;
-    node._score = score;
-    node._depth = priority;
-    node._move = move;
-    if (score <= alpha)
-      node._type = MTDFTTNode::Type::Upper;
-    else if (score >= beta)
-      node._type = MTDFTTNode::Type::Lower;
+  syncGeneration();
+  MTDFTTNode result;
+  result._score = score;
+  result._depth = priority;
+  result._move = move;
+  result._generation = _generation;
+  if (score <= alpha)
+    result._type = uint8_t(MTDFTTNode::Type::Upper);
+  else if (score >= beta)
+    result._type = uint8_t(MTDFTTNode::Type::Lower);
+  else
+    result._type = uint8_t(MTDFTTNode::Type::Exact);
+
+  if (nullptr != _hot && priority >= _hotDepth) setHot(key, result);
+
+  Bucket& bucket = getBucket(key);
+  const uint32_t fragment = getFragment(key);
+
+  Replacement reason = Replacement::Deeper;
+  int slot = find(bucket, fragment);
+  if (slot >= 0) {
+    // the same position is only overwritten by a deeper result
+    MTDFTTNode node(bucket._nodes[slot]);
+    if (node._depth >= priority) {
+      if (node._generation != _generation) {
+        node._generation = _generation;
+        write(bucket, slot, fragment, node);
+      }
+      ++_stats.refusals;
+      return false;
+    }
+  } else {
+    slot = getVictim(bucket, priority);
+    const MTDFTTNode& node = bucket._nodes[slot];
+    if (node.empty())
+      reason = Replacement::Empty;
+    else if (Bucket::SIZE - 1 == slot)
+      reason = Replacement::Always;
+    else if (node._generation != _generation)
+      reason = Replacement::Stale;
     else
-      node._type = MTDFTTNode::Type::Exact;
-    return true;
+      reason = Replacement::Shallower;
   }
-  return false;
+  ++_stats.replacements[int(reason)];
+
+  _zeroed = false;
+  write(bucket, slot, fragment, result);
+#ifdef TTABLE_VERIFY
+  _verify[(&bucket - _table) * Bucket::SIZE + slot] = key;
+#endif
+  return true;
+}
+
+int TranspositionTable::getHashfull() const {
+  const size_t sampled = std::min(_buckets, SAMPLE_BUCKETS);
+  if (0 == sampled) return 0;
+
+  size_t occupied = 0;
+  for (size_t i = 0; i < sampled; ++i)
+    for (const MTDFTTNode& node : _table[i]._nodes)
+      if (!node.empty()) ++occupied;
+  return occupied * 1000 / (sampled * Bucket::SIZE);
 }
 
-size_t TranspositionTable::getOccupancy() { return _maxOccupancy; }
+std::array<size_t, HEIGHTMAX> TranspositionTable::getDepthHistogram() const {
+  std::array<size_t, HEIGHTMAX> histogram;
+  histogram.fill(0);
+  const size_t sampled = std::min(_buckets, SAMPLE_BUCKETS);
+  for (size_t i = 0; i < sampled; ++i)
+    for (const MTDFTTNode& node : _table[i]._nodes)
+      if (!node.empty() && node._depth >= 0 && node._depth < HEIGHTMAX)
+        ++histogram[node._depth];
+  return histogram;
+}
 
-size_t TranspositionTable::getSize() { return _size; }
+// Exact, but touches every bucket; prefer getHashfull() while searching.
+size_t TranspositionTable::getOccupancy() {
+  size_t occupancy = 0;
+  for (size_t i = 0; i < _buckets; ++i)
+    for (const MTDFTTNode& node : _table[i]._nodes)
+      if (!node.empty()) ++occupancy;
+  return occupancy;
+}
+
+size_t TranspositionTable::getSize() { return _buckets * Bucket::SIZE; }
+
+uint64_t TranspositionTable::Stats::getHits() const {
+  uint64_t total = 0;
+  for (const uint64_t count : hits) total += count;
+  return total;
+}
+
+uint64_t TranspositionTable::Stats::getCutoffs() const {
+  uint64_t total = 0;
+  for (const uint64_t count : cutoffs) total += count;
+  return total;
+}
+
+// Results stored over a different position's.
+uint64_t TranspositionTable::Stats::getCollisions() const {
+  return replacements[int(Replacement::Stale)] +
+         replacements[int(Replacement::Shallower)] +
+         replacements[int(Replacement::Always)];
+}
 }
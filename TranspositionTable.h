@@ -6,6 +6,11 @@
 #ifndef __TRANSPOSITIONTABLE_H__
 #define __TRANSPOSITIONTABLE_H__
 
+#include <array>
+#include <cstring>
+#include <string>
+#include <vector>
+
 #include "Enums.h"
 #include "MTDFTTNode.h"
 
@@ -13,12 +18,64 @@ namespace BixNix {
 
 class TranspositionTable {
  public:
+  // Why set() wrote over a slot.
+  enum class Replacement : uint8_t {
+    Empty,      // nothing there yet
+    Deeper,     // same position, searched deeper
+    Stale,      // left over from an earlier search
+    Shallower,  // shallowest current result in the depth slots
+    Always,     // the always-replace slot
+    COUNT
+  };
+
+  // Plain counters, so keeping them costs an increment per probe or store.
+  struct Stats {
+    static const int TYPES = 4;
+    static const int REPLACEMENTS = int(Replacement::COUNT);
+
+    uint64_t hits[TYPES];     // deep enough to use, by MTDFTTNode::Type
+    uint64_t cutoffs[TYPES];  // of those, answers rather than just a move
+    uint64_t shallow;         // found, but searched too shallow to use
+    uint64_t misses;
+    uint64_t replacements[REPLACEMENTS];
+    uint64_t refusals;        // same position, kept the deeper result
+    uint64_t falsePositives;  // only counted with TTABLE_VERIFY
+
+    uint64_t hotHits;
+    uint64_t hotMisses;
+    uint64_t hotReplacements;
+    uint64_t hotRejections;
+
+    uint64_t getHits() const;
+    uint64_t getCutoffs() const;
+    uint64_t getCollisions() const;
+  };
+
+  static const size_t SAMPLE_BUCKETS = 1000;
+
   TranspositionTable();
-  TranspositionTable(const size_t size);
+  TranspositionTable(const size_t megabytes);
   ~TranspositionTable();
 
-  void resize(const size_t size);
+  // Always gives this process a fresh table of its own, so a shared table
+  // stops being shared here even at the size it already has.
+  void resize(const size_t megabytes);
+  // Puts a small table of results searched at least minDepth deep in front
+  // of the main one; zero kilobytes turns it off.
+  void resizeHot(const size_t kilobytes, const Depth minDepth);
   void clear();
+  void newSearch();
+
+  bool save(const std::string& path) const;
+  bool load(const std::string& path);
+
+  // Moves the table into the named POSIX shared memory segment, creating it
+  // with megabytes of buckets unless another process already has, so every
+  // process sharing the name probes and stores the same buckets. Fails and
+  // keeps the current table if the segment's layout doesn't match ours.
+  // Only resize() leaves it again.
+  bool share(const std::string& name, const size_t megabytes);
+  static bool unlinkShared(const std::string& name);
 
   bool get(const ZobristNumber key, const Depth priority, Score& alpha,
            Score& beta, Score& score, Move& move);
@@ -26,17 +83,126 @@ class TranspositionTable {
   bool set(const ZobristNumber key, const Depth priority, const Score alpha,
            const Score beta, const Score score, const Move& move);
 
+  // Starts pulling key's bucket into cache ahead of a get() or set().
+  void prefetch(const ZobristNumber key) { __builtin_prefetch(&getBucket(key)); }
+
+  const Stats& getStats() const { return _stats; }
+  void resetStats();
+
+  // Estimates from the first SAMPLE_BUCKETS buckets, cheap enough to report
+  // during a search: occupied slots per mille, and how many of the sampled
+  // nodes were searched to each depth.
+  int getHashfull() const;
+  std::array<size_t, HEIGHTMAX> getDepthHistogram() const;
+
   size_t getOccupancy();
   size_t getSize();
-
-  uint64_t _collisions;
-  uint64_t _misses;
-  uint64_t _hits;
+  bool getHugePages() const { return _hugePages; }
+  bool isShared() const { return _shared; }
 
  private:
-  size_t _maxOccupancy;
-  size_t _size;
-  MTDFTTNode* _table;
+  static const uint8_t GENERATIONS = 64;
+
+  // One cache line. The first DEPTH_SLOTS nodes keep the deepest and most
+  // recent results, the last one takes whatever they turn away. Keys are
+  // kept apart from the nodes so all of them can be compared at once.
+  struct alignas(64) Bucket {
+    static const int SIZE = 5;
+    static const int DEPTH_SLOTS = 4;
+
+    MTDFTTNode _nodes[SIZE];
+    uint32_t _keys[SIZE];
+    uint32_t _padding;
+  };
+
+  static_assert(sizeof(Bucket) == 64, "Bucket should fill one cache line");
+
+  Bucket& getBucket(const ZobristNumber key) {
+    // multiply-shift maps the key onto any bucket count without a modulo
+    return _table[(static_cast<unsigned __int128>(key) * _buckets) >> 64];
+  }
+  Bucket& getHotBucket(const ZobristNumber key) {
+    return _hot[(static_cast<unsigned __int128>(key) * _hotBuckets) >> 64];
+  }
+  static uint32_t getFragment(const ZobristNumber key) {
+    return static_cast<uint32_t>(key);
+  }
+  // Keys are stored XORed with both halves of their node. A node and key
+  // torn apart by another process writing the same slot then no longer
+  // match anything, so a probe sees a miss instead of a wrong result.
+  static uint32_t getCheck(const MTDFTTNode& node) {
+    uint64_t bits;
+    std::memcpy(&bits, &node, sizeof(bits));
+    return static_cast<uint32_t>(bits) ^ static_cast<uint32_t>(bits >> 32);
+  }
+  static void write(Bucket& bucket, const int slot, const uint32_t fragment,
+                    const MTDFTTNode& node) {
+    bucket._nodes[slot] = node;
+    bucket._keys[slot] = fragment ^ getCheck(node);
+  }
+
+  // Saved tables are one page of FileHeader followed by the raw buckets,
+  // so the bucket array can be mapped straight from the file. Shared
+  // segments use the same layout, with _magic written last, and keep the
+  // generation every process sharing them searches in.
+  struct FileHeader {
+    static const uint64_t MAGIC = 0x5454584e5842ULL;  // "BXNXTT"
+    static const uint32_t VERSION = 3;
+    static const size_t PAGE = 4096;
+
+    uint64_t _magic;
+    uint32_t _version;
+    uint32_t _bucketBytes;
+    uint64_t _buckets;
+    uint64_t _zobristSeed;
+    uint8_t _generation;
+  };
+
+  static const size_t HUGE_PAGE_SIZE = 2 * 1024 * 1024;
+  static const size_t FILE_CHUNK_BYTES = 64 * 1024 * 1024;
+  static const size_t PARALLEL_CLEAR_BYTES = 64 * 1024 * 1024;
+  // how long share() waits for another process to set up the segment
+  static const int SHARE_WAIT_TRIES = 1000;
+  static const int SHARE_WAIT_MICROSECONDS = 1000;
+
+  int find(const Bucket& bucket, const uint32_t fragment) const;
+  int getVictim(const Bucket& bucket, const Depth priority) const;
+  int getHotWorth(const MTDFTTNode& node) const;
+
+  bool probe(const MTDFTTNode& node, Score& alpha, Score& beta, Score& score,
+             Move& move) const;
+  void setHot(const ZobristNumber key, const MTDFTTNode& node);
+
+  void resizeBuckets(const size_t buckets);
+  void allocate(const size_t bytes);
+  void release();
+  bool validate(const FileHeader& header, const size_t bytes) const;
+  // Picks up a newSearch() made by another process sharing the table.
+  void syncGeneration() {
+    if (nullptr != _sharedGeneration)
+      _generation = __atomic_load_n(_sharedGeneration, __ATOMIC_RELAXED);
+  }
+
+  Stats _stats;
+  size_t _buckets;
+  uint8_t _generation;
+  uint8_t* _sharedGeneration;
+  Bucket* _table;
+
+  void* _mapping;
+  size_t _mappingBytes;
+  bool _hugePages;
+  bool _zeroed;
+  bool _shared;
+
+  size_t _hotBuckets;
+  Depth _hotDepth;
+  Bucket* _hot;
+
+#ifdef TTABLE_VERIFY
+  // Full keys beside every main table slot, to catch fragment collisions.
+  std::vector<ZobristNumber> _verify;
+#endif
 };
 }
 
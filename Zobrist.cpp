@@ -1,34 +1,70 @@
 #include <array>
-#include <random>
+#include <cstddef>
 
 #include "Zobrist.h"
 
 namespace BixNix {
 
-Zobrist& Zobrist::GetInstance() {
-  static Zobrist instance;
-  return instance;
-}
+namespace {
+
+// std::mt19937_64, which cannot run at compile time. Its numbers are the
+// same, so keys saved by earlier builds still match.
+class MersenneTwister {
+ public:
+  constexpr explicit MersenneTwister(const uint64_t seed)
+      : _state{}, _index(N) {
+    _state[0] = seed;
+    for (size_t i = 1; i < N; ++i)
+      _state[i] = 6364136223846793005ULL *
+                      (_state[i - 1] ^ (_state[i - 1] >> 62)) +
+                  i;
+  }
 
-Zobrist::Zobrist() {
-  std::mt19937_64 getRand;
-  getRand.seed(1234567890LL);
+  constexpr uint64_t operator()() {
+    if (N == _index) twist();
+    uint64_t x(_state[_index++]);
+    x ^= (x >> 29) & 0x5555555555555555ULL;
+    x ^= (x << 17) & 0x71D67FFFEDA60000ULL;
+    x ^= (x << 37) & 0xFFF7EEE000000000ULL;
+    x ^= x >> 43;
+    return x;
+  }
 
-  _blackToMove = getRand();
-  _WQCastle = getRand();
-  _WKCastle = getRand();
-  _BQCastle = getRand();
-  _BKCastle = getRand();
+ private:
+  static constexpr size_t N = 312;
+  static constexpr size_t M = 156;
 
-  for (ZobristNumber& z : _pieces) z = getRand();
+  constexpr void twist() {
+    for (size_t i = 0; i < N; ++i) {
+      const uint64_t x((_state[i] & 0xFFFFFFFF80000000ULL) |
+                       (_state[(i + 1) % N] & 0x7FFFFFFFULL));
+      _state[i] = _state[(i + M) % N] ^ (x >> 1) ^
+                  ((x & 1) ? 0xB5026F5AA96619E9ULL : 0ULL);
+    }
+    _index = 0;
+  }
 
-  for (ZobristNumber& z : _epFile) z = getRand();
+  std::array<uint64_t, N> _state;
+  size_t _index;
+};
 }
 
-ZobristNumber Zobrist::getZobrist(Color color, Piece piece, Square square) {
-  size_t offset = (color * 364) + (piece * 64) + square;
-  return _pieces[offset];
+constexpr Zobrist::Keys Zobrist::generateKeys() {
+  MersenneTwister getRand(SEED);
+  Keys keys{};
+
+  keys.blackToMove = getRand();
+  keys.WQCastle = getRand();
+  keys.WKCastle = getRand();
+  keys.BQCastle = getRand();
+  keys.BKCastle = getRand();
+
+  for (ZobristNumber& z : keys.pieces) z = getRand();
+
+  for (ZobristNumber& z : keys.epFile) z = getRand();
+
+  return keys;
 }
 
-ZobristNumber Zobrist::getEPFile(const int file) { return _epFile[file]; }
+constexpr Zobrist::Keys Zobrist::KEYS = Zobrist::generateKeys();
 }
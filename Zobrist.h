@@ -1,32 +1,44 @@
 #ifndef _ZOBRIST_H_
 #define _ZOBRIST_H_
 
+#include <array>
+
 #include "Enums.h"
 
 namespace BixNix {
 
 class Zobrist {
  public:
-  static Zobrist& GetInstance();
-  virtual ~Zobrist() {}
+  static const uint64_t SEED = 1234567890LL;
 
-  ZobristNumber getZobrist(Color color, Piece piece, Square square);
-  ZobristNumber getEPFile(int file);
-  ZobristNumber getBlackToMove() { return _blackToMove; }
-  ZobristNumber getWQCastle() { return _WQCastle; }
-  ZobristNumber getWKCastle() { return _WKCastle; }
-  ZobristNumber getBQCastle() { return _BQCastle; }
-  ZobristNumber getBKCastle() { return _BKCastle; }
+  static ZobristNumber getZobrist(Color color, Piece piece, Square square) {
+    return KEYS.pieces[(color * 384) + (piece * 64) + square];
+  }
+  template <Color color>
+  static ZobristNumber getZobrist(const Piece piece, const Square square) {
+    return KEYS.pieces[(color * 384) + (piece * 64) + square];
+  }
+  static ZobristNumber getEPFile(const int file) { return KEYS.epFile[file]; }
+  static ZobristNumber getBlackToMove() { return KEYS.blackToMove; }
+  static ZobristNumber getWQCastle() { return KEYS.WQCastle; }
+  static ZobristNumber getWKCastle() { return KEYS.WKCastle; }
+  static ZobristNumber getBQCastle() { return KEYS.BQCastle; }
+  static ZobristNumber getBKCastle() { return KEYS.BKCastle; }
 
  protected:
-  Zobrist();
-  std::array<ZobristNumber, 768> _pieces;
-  std::array<ZobristNumber, 8> _epFile;
-  ZobristNumber _blackToMove;
-  ZobristNumber _WQCastle;
-  ZobristNumber _WKCastle;
-  ZobristNumber _BQCastle;
-  ZobristNumber _BKCastle;
+  struct Keys {
+    std::array<ZobristNumber, 768> pieces;
+    std::array<ZobristNumber, 8> epFile;
+    ZobristNumber blackToMove;
+    ZobristNumber WQCastle;
+    ZobristNumber WKCastle;
+    ZobristNumber BQCastle;
+    ZobristNumber BKCastle;
+  };
+
+  static constexpr Keys generateKeys();
+  // defined constexpr in Zobrist.cpp, so it is filled in at compile time
+  static const Keys KEYS;
 };
 }
 
@@ -0,0 +1,17 @@
+#include <cstring>
+
+#include "Logger.h"
+#include "Tests.h"
+
+// Games are played by whatever embeds Engine; on its own the binary only
+// runs the self tests that `make test` asks for.
+int main(int argc, char** argv) {
+  if (2 != argc || 0 != std::strcmp("--test", argv[1])) {
+    LOG(fatal) << "usage: " << argv[0] << " --test";
+    return 2;
+  }
+
+  // searches log every move at trace, so keep to the verdicts
+  SetLogLevel(3);
+  return BixNix::Tests::run() ? 0 : 1;
+}